@@ -21,6 +21,14 @@ export default class Session extends EventEmitter {
     });
   }
 
+  // Selects a dissector built into paperfilter, e.g. 'tcp', in place of a
+  // script.
+  registerNativeDissector(name) {
+    this._dissectors.push({
+      native: name
+    });
+  }
+
   registerStreamDissector(script) {
     this._streamDissectors.push({
       script
@@ -34,6 +42,13 @@ export default class Session extends EventEmitter {
     }
   }
 
+  unregisterNativeDissector(name) {
+    let index = this._dissectors.findIndex(e => e.native === name);
+    if (index >= 0) {
+      this._dissectors.splice(index, 1);
+    }
+  }
+
   unregisterStreamDissector(script) {
     let index = this._streamDissectors.find(e => e.path === script);
     if (index != null) {
@@ -2,7 +2,7 @@ import { Session } from 'dripcap';
 
 export default class Ethernet {
   activate() {
-    Session.registerDissector(`${__dirname}/eth.es`);
+    Session.registerNativeDissector('ethernet');
     Session.registerFilterHints('eth', [
       {filter: 'eth',                description: 'Ethernet'},
       {filter: 'eth.dst',            description: 'Destination'},
@@ -15,7 +15,7 @@ export default class Ethernet {
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/eth.es`);
+    Session.unregisterNativeDissector('ethernet');
     Session.unregisterFilterHints('eth');
   }
 }
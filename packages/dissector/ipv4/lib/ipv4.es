@@ -93,7 +93,7 @@ export default class Dissector {
       ]
     });
 
-    let fragmentOffset = parentLayer.payload.readUInt8(6) & 0b0001111111111111;
+    let fragmentOffset = parentLayer.payload.readUInt16BE(6) & 0b0001111111111111;
     layer.items.push({
       name: 'Fragment Offset',
       id: 'fragmentOffset',
@@ -156,12 +156,15 @@ export default class Dissector {
       value: destination
     });
 
-    layer.range = '20:' + totalLength;
-    layer.payload = parentLayer.payload.slice(20, totalLength.data);
+    let payloadStart = Math.max(20, headerLength * 4);
+    let payloadEnd = Math.max(payloadStart,
+      Math.min(totalLength, parentLayer.payload.length));
+    layer.range = `${payloadStart}:${payloadEnd}`;
+    layer.payload = parentLayer.payload.slice(payloadStart, payloadEnd);
     layer.items.push({
       name: 'Payload',
       id: 'payload',
-      range: '20:' + totalLength,
+      range: layer.range,
       value: layer.payload
     });
 
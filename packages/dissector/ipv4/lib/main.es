@@ -2,7 +2,7 @@ import { Session } from 'dripcap';
 
 export default class IPv4 {
   activate() {
-    Session.registerDissector(`${__dirname}/ipv4.es`);
+    Session.registerNativeDissector('ipv4');
     Session.registerFilterHints('ipv4', [
       {filter: 'ipv4',                     description: 'IPv4'},
       {filter: 'ipv4.version',             description: 'Version'},
@@ -26,7 +26,7 @@ export default class IPv4 {
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/ipv4.es`);
+    Session.unregisterNativeDissector('ipv4');
     Session.unregisterFilterHints('ipv4');
   }
 }
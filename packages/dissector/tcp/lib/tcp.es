@@ -89,7 +89,7 @@ export default class Dissector {
     layer.items.push({
       name: 'Flags',
       id: 'flags',
-      data: '12:14',
+      range: '12:14',
       value: flagValue,
       summary: flags.toString(),
       items: [
@@ -174,7 +174,7 @@ export default class Dissector {
       value: urgent
     });
 
-    let optionDataOffset = dataOffset * 4;
+    let optionDataOffset = Math.min(dataOffset * 4, parentLayer.payload.length);
     let optionItems = [];
     let option = {
       name: 'Options',
@@ -183,9 +183,10 @@ export default class Dissector {
     };
 
     let optionOffset = 20;
+    let view = parentLayer.payload.dataView;
 
     while (optionDataOffset > optionOffset) {
-      switch (parentLayer.payload[optionOffset]) {
+      switch (view.getUint8(optionOffset)) {
         case 0:
           optionOffset = optionDataOffset;
           break;
@@ -202,7 +203,7 @@ export default class Dissector {
           optionItems.push('Maximum segment size');
           option.items.push({
             name: 'Maximum segment size',
-            value: parentLayer.payload.readUInt16BE(optionOffset + 2),
+            value: view.getUint16(optionOffset + 2),
             range: `${optionOffset}:${optionOffset + 4}`
           });
           optionOffset += 4;
@@ -212,7 +213,7 @@ export default class Dissector {
           optionItems.push('Window scale');
           option.items.push({
             name: 'Window scale',
-            value: parentLayer.payload.readUInt8(optionOffset + 2),
+            value: view.getUint8(optionOffset + 2),
             range: `${optionOffset}:${optionOffset + 3}`
           });
           optionOffset += 3;
@@ -229,20 +230,20 @@ export default class Dissector {
 
         // TODO: https://tools.ietf.org/html/rfc2018
         case 5:
-          let length = parentLayer.payload.readUInt8(optionOffset + 1);
+          let length = view.getUint8(optionOffset + 1);
           optionItems.push('Selective ACK');
           option.items.push({
             name: 'Selective ACK',
             value: parentLayer.payload.slice(optionOffset + 2, optionOffset + length),
-            data: `${optionOffset}:${optionOffset + length}`
+            range: `${optionOffset}:${optionOffset + length}`
           });
 
           optionOffset += length;
           break;
 
         case 8:
-          let mt = parentLayer.payload.readUInt32BE(optionOffset + 2);
-          let et = parentLayer.payload.readUInt32BE(optionOffset + 2);
+          let mt = view.getUint32(optionOffset + 2);
+          let et = view.getUint32(optionOffset + 6);
           optionItems.push('Timestamps');
           option.items.push({
             name: 'Timestamps',
@@ -2,7 +2,7 @@ import { Session } from 'dripcap';
 
 export default class UDP {
   activate() {
-    Session.registerDissector(`${__dirname}/udp.es`);
+    Session.registerNativeDissector('udp');
     Session.registerFilterHints('udp', [
       {filter: 'udp',                description: 'UDP'},
       {filter: 'udp.srcPort',        description: 'Source port'},
@@ -17,7 +17,7 @@ export default class UDP {
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/udp.es`);
+    Session.unregisterNativeDissector('udp');
     Session.unregisterFilterHints('udp');
   }
 }
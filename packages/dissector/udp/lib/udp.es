@@ -61,13 +61,14 @@ export default class UDPDissector {
       value: checksum
     });
 
-    layer.range = '8:'+ length;
-    layer.payload = parentLayer.payload.slice(8, length);
+    let payloadEnd = Math.max(8, Math.min(length, parentLayer.payload.length));
+    layer.range = '8:' + payloadEnd;
+    layer.payload = parentLayer.payload.slice(8, payloadEnd);
 
     layer.items.push({
       name: 'Payload',
       id: 'payload',
-      range: '8:' + length,
+      range: layer.range,
       value: layer.payload
     });
 
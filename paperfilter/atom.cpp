@@ -0,0 +1,92 @@
+#include "atom.hpp"
+#include <atomic>
+#include <unordered_map>
+#include <uv.h>
+
+namespace {
+// Strings live in fixed-size chunks that are never moved, so str() can
+// read them without taking the lock.
+const uint32_t chunkBits = 12;
+const uint32_t chunkSize = 1 << chunkBits;
+const uint32_t maxChunks = 256;
+const uint32_t unknown = UINT32_MAX;
+
+// Atom::bounded() stops interning beyond this many atoms, leaving the rest
+// of the table to declared names.
+const uint32_t boundedLimit = 1 << 16;
+
+class AtomTable {
+public:
+  AtomTable() {
+    uv_rwlock_init(&rwlock);
+    for (auto &chunk : chunks) {
+      chunk.store(nullptr);
+    }
+    chunks[0].store(new std::string[chunkSize]);
+    ids.emplace(std::string(), 0);
+    count = 1;
+  }
+
+  uint32_t find(const std::string &str) {
+    uv_rwlock_rdlock(&rwlock);
+    auto it = ids.find(str);
+    uint32_t id = it != ids.end() ? it->second : unknown;
+    uv_rwlock_rdunlock(&rwlock);
+    return id;
+  }
+
+  // Returns unknown once |limit| atoms exist.
+  uint32_t intern(const std::string &str, uint32_t limit) {
+    uint32_t id = find(str);
+    if (id != unknown)
+      return id;
+
+    uv_rwlock_wrlock(&rwlock);
+    auto it = ids.find(str);
+    if (it != ids.end()) {
+      id = it->second;
+    } else if (count < limit) {
+      id = count++;
+      std::string *chunk = chunks[id >> chunkBits].load();
+      if (!chunk) {
+        chunk = new std::string[chunkSize];
+        chunks[id >> chunkBits].store(chunk);
+      }
+      chunk[id & (chunkSize - 1)] = str;
+      ids.emplace(str, id);
+    }
+    uv_rwlock_wrunlock(&rwlock);
+    return id;
+  }
+
+  const std::string &str(uint32_t id) const {
+    static const std::string empty;
+    if (id == unknown)
+      return empty;
+    return chunks[id >> chunkBits].load()[id & (chunkSize - 1)];
+  }
+
+private:
+  uv_rwlock_t rwlock;
+  std::unordered_map<std::string, uint32_t> ids;
+  std::atomic<std::string *> chunks[maxChunks];
+  uint32_t count;
+};
+
+AtomTable &table() {
+  static AtomTable *table = new AtomTable();
+  return *table;
+}
+}
+
+Atom::Atom(const std::string &str)
+    : value(table().intern(str, chunkSize * maxChunks)) {}
+
+bool Atom::bounded(const std::string &str, Atom *atom) {
+  *atom = Atom(table().intern(str, boundedLimit));
+  return atom->valid();
+}
+
+Atom Atom::find(const std::string &str) { return Atom(table().find(str)); }
+
+const std::string &Atom::str() const { return table().str(value); }
@@ -0,0 +1,53 @@
+#ifndef ATOM_HPP
+#define ATOM_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Atom is a 32-bit handle to a string interned in a process-wide table,
+// so that recurring names such as layer namespaces and item ids are stored
+// once and compared as integers. Interned strings are never freed, so
+// values that vary with the traffic are only interned through bounded(),
+// and the caller keeps the string itself when that fails.
+class Atom {
+public:
+  Atom() : value(0) {}
+  // Interns |str|. Meant for names declared by dissectors and filters, such
+  // as layer namespaces, names and ids. Once the table is full this yields
+  // an invalid atom.
+  explicit Atom(const std::string &str);
+
+  // Interns |str| into |atom| only while the table is small and returns
+  // whether it did. Meant for names that are usually declared but may be
+  // taken from packet data, such as item ids. On failure |atom| is set to
+  // an invalid atom.
+  static bool bounded(const std::string &str, Atom *atom);
+
+  // Returns the atom of |str| without interning it. Unknown strings yield
+  // an invalid atom.
+  static Atom find(const std::string &str);
+
+  uint32_t id() const { return value; }
+  const std::string &str() const;
+  bool empty() const { return value == 0; }
+  // Invalid atoms differ from every interned one but equal each other.
+  bool valid() const { return value != UINT32_MAX; }
+
+  bool operator==(Atom other) const { return value == other.value; }
+  bool operator!=(Atom other) const { return value != other.value; }
+
+private:
+  explicit Atom(uint32_t value) : value(value) {}
+
+private:
+  uint32_t value;
+};
+
+namespace std {
+template <> struct hash<Atom> {
+  size_t operator()(Atom atom) const { return atom.id(); }
+};
+}
+
+#endif
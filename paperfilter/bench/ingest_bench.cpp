@@ -0,0 +1,172 @@
+// Measures the capture-thread side of ingest: frames copied out of a
+// capture buffer and handed to dissector workers, either one call per frame
+// (pcap_loop with packetCb) or through PacketBatcher (packetsCb).
+//
+//   make bench-ingest
+//   BENCH_FRAMES=4000000 BENCH_WORKERS=4 make bench-ingest
+//
+// The hand-off mirrors PacketDispatcher::analyze(): every frame goes into
+// a WorkQueue, and sleeping workers are woken once per call. Workers pop
+// batches like DissectorThread but do no dissection, so the figures bound
+// what the capture path alone can sustain.
+
+#include "../packet_batcher.hpp"
+#include "../work_queue.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+const size_t frameSize = 128;
+const size_t dissectorQuota = 512;
+
+struct Frame {
+  uint32_t seq;
+  char bytes[frameSize];
+};
+
+typedef std::unique_ptr<Frame> FramePtr;
+
+class Dispatcher {
+public:
+  explicit Dispatcher(size_t workers) {
+    for (size_t i = 0; i < workers; ++i) {
+      threads.emplace_back([this]() { work(); });
+    }
+  }
+
+  ~Dispatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closing = true;
+    }
+    cond.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+
+  void analyze(FramePtr frame) {
+    queue.push(std::move(frame));
+    wake(false);
+  }
+
+  void analyze(std::vector<FramePtr> frames) {
+    for (FramePtr &frame : frames) {
+      queue.push(std::move(frame));
+    }
+    wake(true);
+  }
+
+  void wait(size_t frames) {
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCond.wait(lock, [this, frames] { return consumed >= frames; });
+  }
+
+private:
+  void wake(bool all) {
+    if (sleepers.load() == 0)
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (all) {
+      cond.notify_all();
+    } else {
+      cond.notify_one();
+    }
+  }
+
+  void work() {
+    std::vector<FramePtr> frames;
+    while (true) {
+      frames.clear();
+      queue.pop(&frames, dissectorQuota);
+      if (frames.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++sleepers;
+        cond.wait(lock, [this] { return !queue.empty() || closing; });
+        --sleepers;
+        if (closing)
+          return;
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      consumed += frames.size();
+      doneCond.notify_all();
+    }
+  }
+
+private:
+  WorkQueue<FramePtr> queue;
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::condition_variable doneCond;
+  std::atomic<size_t> sleepers{0};
+  size_t consumed = 0;
+  bool closing = false;
+};
+
+FramePtr capture(const char *buffer, uint32_t seq) {
+  FramePtr frame(new Frame());
+  frame->seq = seq;
+  std::memcpy(frame->bytes, buffer, frameSize);
+  return frame;
+}
+
+double runSingle(size_t frames, size_t workers) {
+  char buffer[frameSize] = {0};
+  Dispatcher dispatcher(workers);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frames; ++i) {
+    dispatcher.analyze(capture(buffer, i));
+  }
+  dispatcher.wait(frames);
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  return frames / sec.count();
+}
+
+double runBatched(size_t frames, size_t workers) {
+  char buffer[frameSize] = {0};
+  Dispatcher dispatcher(workers);
+  PacketBatcher<FramePtr> batcher([&dispatcher](std::vector<FramePtr> batch) {
+    dispatcher.analyze(std::move(batch));
+  });
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < frames; ++i) {
+    batcher.push(capture(buffer, i));
+    if (i % 64 == 63)
+      batcher.poll();
+  }
+  batcher.flush();
+  dispatcher.wait(frames);
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  return frames / sec.count();
+}
+}
+
+int main() {
+  const char *env = std::getenv("BENCH_FRAMES");
+  size_t frames = env ? std::stoul(env) : 2000000;
+  env = std::getenv("BENCH_WORKERS");
+  size_t workers = env ? std::stoul(env) : 2;
+  const int rounds = 5;
+
+  double single = 0;
+  double batched = 0;
+  for (int i = 0; i < rounds; ++i) {
+    single += runSingle(frames, workers) / rounds;
+    batched += runBatched(frames, workers) / rounds;
+  }
+  std::printf("workers: %zu per-frame: %.0fpackets/sec "
+              "batched: %.0fpackets/sec (x%.2f)\n",
+              workers, single, batched, batched / single);
+  return 0;
+}
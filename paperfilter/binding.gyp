@@ -10,8 +10,14 @@
             "log_message.cpp",
             "console.cpp",
             "buffer.cpp",
+            "slab_allocator.cpp",
             "large_buffer.cpp",
+            "serialization.cpp",
+            "atom.cpp",
             "layer.cpp",
+            "layer_arena.cpp",
+            "layer_id_table.cpp",
+            "namespace_table.cpp",
             "item.cpp",
             "item_value.cpp",
             "session.cpp",
@@ -19,13 +25,20 @@
             "packet_store.cpp",
             "packet_dispatcher.cpp",
             "filtered_packet_store.cpp",
+            "roaring_bitmap.cpp",
+            "field_index.cpp",
             "stream_chunk.cpp",
             "paper_context.cpp",
+            "isolate_pool.cpp",
+            "script_cache.cpp",
             "dissector.cpp",
+            "native_dissector.cpp",
             "dissector_thread.cpp",
             "stream_dissector_thread.cpp",
             "filter.cpp",
+            "filter_program.cpp",
             "filter_thread.cpp",
+            "filter_dispatcher.cpp",
             "stream_dispatcher.cpp",
             "vendor/json11/json11.cpp",
             "vendor/v8pp/v8pp/context.cpp"
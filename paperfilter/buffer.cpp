@@ -1,7 +1,15 @@
 #include "buffer.hpp"
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 #include <v8pp/class.hpp>
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+#if V8_MAJOR_VERSION > 6 || (V8_MAJOR_VERSION == 6 && V8_MINOR_VERSION >= 7)
+#define BUFFER_BIGINT
+#endif
 
 using namespace v8;
 
@@ -69,6 +77,158 @@ std::string hex(const char *data, size_t len) {
   }
   return str;
 }
+
+// The smallest unsigned type of each size, used to swap bytes.
+template <size_t size> struct Word;
+template <> struct Word<1> { typedef uint8_t type; };
+template <> struct Word<2> { typedef uint16_t type; };
+template <> struct Word<4> { typedef uint32_t type; };
+template <> struct Word<8> { typedef uint64_t type; };
+
+uint8_t byteSwap(uint8_t word) { return word; }
+
+uint16_t byteSwap(uint16_t word) {
+#ifdef _MSC_VER
+  return _byteswap_ushort(word);
+#else
+  return __builtin_bswap16(word);
+#endif
+}
+
+uint32_t byteSwap(uint32_t word) {
+#ifdef _MSC_VER
+  return _byteswap_ulong(word);
+#else
+  return __builtin_bswap32(word);
+#endif
+}
+
+uint64_t byteSwap(uint64_t word) {
+#ifdef _MSC_VER
+  return _byteswap_uint64(word);
+#else
+  return __builtin_bswap64(word);
+#endif
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+const bool hostLittleEndian = false;
+#else
+const bool hostLittleEndian = true;
+#endif
+
+template <class T> T load(const char *data, bool littleEndian) {
+  typename Word<sizeof(T)>::type word;
+  std::memcpy(&word, data, sizeof(T));
+  if (littleEndian != hostLittleEndian)
+    word = byteSwap(word);
+  T value;
+  std::memcpy(&value, &word, sizeof(T));
+  return value;
+}
+
+template <class T>
+void setResult(v8::Isolate *, v8::ReturnValue<v8::Value> result, T value) {
+  result.Set(value);
+}
+
+void setResult(v8::Isolate *isolate, v8::ReturnValue<v8::Value> result,
+               int64_t value) {
+#ifdef BUFFER_BIGINT
+  result.Set(v8::BigInt::New(isolate, value));
+#else
+  result.Set(static_cast<double>(value));
+#endif
+}
+
+void setResult(v8::Isolate *isolate, v8::ReturnValue<v8::Value> result,
+               uint64_t value) {
+#ifdef BUFFER_BIGINT
+  result.Set(v8::BigInt::NewFromUnsigned(isolate, value));
+#else
+  result.Set(static_cast<double>(value));
+#endif
+}
+
+// Arguments follow the Node.js readers: (offset, noAssert). Only the
+// original big-endian readers (|legacyNoAssert|) keep their default of
+// skipping the check; every other reader checks the bounds regardless of
+// noAssert.
+template <class T>
+void readNumber(const Buffer &buffer,
+                const v8::FunctionCallbackInfo<v8::Value> &args,
+                bool littleEndian, bool legacyNoAssert = false) {
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
+  bool noassert =
+      legacyNoAssert && v8pp::from_v8<bool>(isolate, args[1], true);
+  if (!noassert &&
+      (offset > buffer.length() || buffer.length() - offset < sizeof(T))) {
+    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
+  } else {
+    setResult(isolate, args.GetReturnValue(),
+              load<T>(buffer.data(offset), littleEndian));
+  }
+}
+
+// Arguments: (offset, count, littleEndian). Returns a typed array holding
+// a converted copy of |count| values.
+template <class T, class Array>
+void readArray(const Buffer &buffer,
+               const v8::FunctionCallbackInfo<v8::Value> &args) {
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
+  size_t count = v8pp::from_v8<size_t>(isolate, args[1], 0);
+  bool littleEndian = v8pp::from_v8<bool>(isolate, args[2], false);
+  if (offset > buffer.length() ||
+      count > (buffer.length() - offset) / sizeof(T)) {
+    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
+    return;
+  }
+
+  v8::Local<v8::ArrayBuffer> array =
+      v8::ArrayBuffer::New(isolate, count * sizeof(T));
+  T *values = static_cast<T *>(array->GetContents().Data());
+  const char *data = buffer.data(offset);
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = load<T>(data + i * sizeof(T), littleEndian);
+  }
+  args.GetReturnValue().Set(Array::New(array, 0, count));
+}
+
+// Keeps the storage of an externalized ArrayBuffer alive until V8
+// collects it, and reports the aliased bytes to V8 meanwhile.
+struct ExternalStorage {
+  std::shared_ptr<const char> source;
+  int64_t size;
+  v8::Persistent<v8::ArrayBuffer> handle;
+};
+
+void releaseStorage(const v8::WeakCallbackInfo<ExternalStorage> &data) {
+  ExternalStorage *storage = data.GetParameter();
+  data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(-storage->size);
+  storage->handle.Reset();
+  delete storage;
+}
+
+// Looks up a view cached on the wrapper object under the given key.
+bool cachedView(v8::Local<v8::Object> holder, const char *name,
+                v8::Local<v8::Value> *value) {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Private> key =
+      Private::ForApi(isolate, v8pp::to_v8(isolate, name).As<String>());
+  return holder->GetPrivate(isolate->GetCurrentContext(), key)
+             .ToLocal(value) &&
+         (*value)->IsObject();
+}
+
+void cacheView(v8::Local<v8::Object> holder, const char *name,
+               v8::Local<v8::Value> value) {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<Private> key =
+      Private::ForApi(isolate, v8pp::to_v8(isolate, name).As<String>());
+  holder->SetPrivate(isolate->GetCurrentContext(), key, value);
+}
 }
 
 class Buffer::Private {
@@ -77,9 +237,9 @@ public:
   ~Private();
 
 public:
-  std::shared_ptr<std::vector<char>> source =
-      std::make_shared<std::vector<char>>();
+  std::shared_ptr<const char> source;
   std::shared_ptr<bool> readonly = std::make_shared<bool>(false);
+  size_t size = 0;
   size_t start = 0;
   size_t end = 0;
 };
@@ -92,8 +252,16 @@ Buffer::Buffer() : d(new Private()) {}
 
 Buffer::Buffer(const std::shared_ptr<std::vector<char>> &source)
     : d(new Private()) {
+  d->source = std::shared_ptr<const char>(source, source->data());
+  d->size = source->size();
+  d->end = d->size;
+}
+
+Buffer::Buffer(const std::shared_ptr<const char> &source, size_t size)
+    : d(new Private()) {
   d->source = source;
-  d->end = d->source->size();
+  d->size = size;
+  d->end = size;
 }
 
 Buffer::Buffer(const v8::FunctionCallbackInfo<v8::Value> &args)
@@ -138,8 +306,9 @@ Buffer::Buffer(const v8::FunctionCallbackInfo<v8::Value> &args)
         isolate, "First argument must be a string, Buffer, or Array"));
   }
 
-  d->source = buf;
-  d->end = d->source->size();
+  d->source = std::shared_ptr<const char>(buf, buf->data());
+  d->size = buf->size();
+  d->end = d->size;
 }
 
 Buffer::~Buffer() {}
@@ -147,9 +316,9 @@ Buffer::~Buffer() {}
 size_t Buffer::length() const { return d->end - d->start; }
 
 std::unique_ptr<Buffer> Buffer::slice(size_t start, size_t end) const {
-  std::unique_ptr<Buffer> buf(new Buffer(d->source));
+  std::unique_ptr<Buffer> buf(new Buffer(d->source, d->size));
   buf->d->readonly = d->readonly;
-  buf->d->start = std::min(d->start + start, d->source->size());
+  buf->d->start = std::min(d->start + start, d->size);
   buf->d->end = std::min(buf->d->start + (end - start), d->end);
   return buf;
 }
@@ -169,116 +338,125 @@ void Buffer::sliceBuffer(
 }
 
 void Buffer::readInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int8_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    args.GetReturnValue().Set(data(offset)[0]);
-  }
+  readNumber<int8_t>(*this, args, false, true);
 }
 
 void Buffer::readInt16BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int16_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[2] = {data(offset)[1], data(offset)[0]};
-    int16_t num = *reinterpret_cast<const int16_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  readNumber<int16_t>(*this, args, false, true);
+}
+
+void Buffer::readInt16LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<int16_t>(*this, args, true);
 }
 
 void Buffer::readInt32BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int32_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[4] = {data(offset)[3], data(offset)[2], data(offset)[1],
-                         data(offset)[0]};
-    int32_t num = *reinterpret_cast<const int32_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  readNumber<int32_t>(*this, args, false, true);
+}
+
+void Buffer::readInt32LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<int32_t>(*this, args, true);
 }
 
 void Buffer::readUInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint8_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    args.GetReturnValue().Set(*reinterpret_cast<const uint8_t *>(data(offset)));
-  }
+  readNumber<uint8_t>(*this, args, false, true);
 }
 
 void Buffer::readUInt16BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint16_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[2] = {data(offset)[1], data(offset)[0]};
-    uint16_t num = *reinterpret_cast<const uint16_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  readNumber<uint16_t>(*this, args, false, true);
+}
+
+void Buffer::readUInt16LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<uint16_t>(*this, args, true);
 }
 
 void Buffer::readUInt32BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint32_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[4] = {data(offset)[3], data(offset)[2], data(offset)[1],
-                         data(offset)[0]};
-    uint32_t num = *reinterpret_cast<const uint32_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  readNumber<uint32_t>(*this, args, false, true);
+}
+
+void Buffer::readUInt32LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<uint32_t>(*this, args, true);
+}
+
+void Buffer::readBigInt64BE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<int64_t>(*this, args, false);
+}
+
+void Buffer::readBigInt64LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<int64_t>(*this, args, true);
+}
+
+void Buffer::readBigUInt64BE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<uint64_t>(*this, args, false);
+}
+
+void Buffer::readBigUInt64LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<uint64_t>(*this, args, true);
 }
 
 void Buffer::readDoubleBE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(double) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[8] = {data(offset)[7], data(offset)[6], data(offset)[5],
-                         data(offset)[4], data(offset)[3], data(offset)[2],
-                         data(offset)[1], data(offset)[0]};
-    double num = *reinterpret_cast<const double *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  readNumber<double>(*this, args, false, true);
+}
+
+void Buffer::readDoubleLE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<double>(*this, args, true);
 }
 
 void Buffer::readFloatBE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<float>(*this, args, false, true);
+}
+
+void Buffer::readFloatLE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readNumber<float>(*this, args, true);
+}
+
+void Buffer::readBits(const v8::FunctionCallbackInfo<v8::Value> &args) const {
   Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(float) > length()) {
+  size_t bitOffset = v8pp::from_v8<size_t>(isolate, args[0], 0);
+  size_t bitLength = v8pp::from_v8<size_t>(isolate, args[1], 1);
+  size_t offset = bitOffset / 8;
+  size_t shift = bitOffset % 8;
+  size_t bytes = (shift + bitLength + 7) / 8;
+  if (bitLength == 0 || bitLength > 32) {
+    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "invalid bit length"));
+  } else if (offset > length() || length() - offset < bytes) {
     args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
   } else {
-    const char buf[4] = {data(offset)[3], data(offset)[2], data(offset)[1],
-                         data(offset)[0]};
-    float num = *reinterpret_cast<const float *>(buf);
+    uint64_t word = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+      word = (word << 8) | static_cast<uint8_t>(data(offset)[i]);
+    }
+    word >>= bytes * 8 - shift - bitLength;
+    uint32_t num = word & ((uint64_t(1) << bitLength) - 1);
     args.GetReturnValue().Set(num);
   }
 }
 
+void Buffer::readUInt16Array(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readArray<uint16_t, v8::Uint16Array>(*this, args);
+}
+
+void Buffer::readUInt32Array(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  readArray<uint32_t, v8::Uint32Array>(*this, args);
+}
+
 void Buffer::toString(const v8::FunctionCallbackInfo<v8::Value> &args) const {
   Isolate *isolate = Isolate::GetCurrent();
   const std::string &type =
@@ -337,7 +515,50 @@ void Buffer::get(uint32_t index,
 }
 
 const char *Buffer::data(size_t offset) const {
-  return d->source->data() + d->start + offset;
+  return d->source.get() + d->start + offset;
+}
+
+v8::Local<v8::ArrayBuffer>
+Buffer::arrayBuffer(v8::Local<v8::Object> holder) const {
+  Local<Value> cached;
+  if (cachedView(holder, "paperfilter:arrayBuffer", &cached)) {
+    return cached.As<ArrayBuffer>();
+  }
+
+  // Alias only this slice of the storage.
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<ArrayBuffer> buffer =
+      ArrayBuffer::New(isolate, const_cast<char *>(data()), length(),
+                       ArrayBufferCreationMode::kExternalized);
+  ExternalStorage *storage = new ExternalStorage();
+  storage->source = d->source;
+  storage->size = static_cast<int64_t>(length());
+  storage->handle.Reset(isolate, buffer);
+  storage->handle.SetWeak(storage, releaseStorage,
+                          WeakCallbackType::kParameter);
+  isolate->AdjustAmountOfExternalAllocatedMemory(storage->size);
+  cacheView(holder, "paperfilter:arrayBuffer", buffer);
+  return buffer;
+}
+
+void Buffer::bytes(v8::Local<v8::String> name,
+                   const v8::PropertyCallbackInfo<v8::Value> &info) const {
+  Local<Value> view;
+  if (!cachedView(info.This(), "paperfilter:bytes", &view)) {
+    view = Uint8Array::New(arrayBuffer(info.This()), 0, length());
+    cacheView(info.This(), "paperfilter:bytes", view);
+  }
+  info.GetReturnValue().Set(view);
+}
+
+void Buffer::dataView(v8::Local<v8::String> name,
+                      const v8::PropertyCallbackInfo<v8::Value> &info) const {
+  Local<Value> view;
+  if (!cachedView(info.This(), "paperfilter:dataView", &view)) {
+    view = DataView::New(arrayBuffer(info.This()), 0, length());
+    cacheView(info.This(), "paperfilter:dataView", view);
+  }
+  info.GetReturnValue().Set(view);
 }
 
 void Buffer::from(const v8::FunctionCallbackInfo<v8::Value> &args) {
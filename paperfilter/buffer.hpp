@@ -9,6 +9,7 @@ class Buffer {
 public:
   Buffer();
   Buffer(const std::shared_ptr<std::vector<char>> &source);
+  Buffer(const std::shared_ptr<const char> &source, size_t size);
   explicit Buffer(const v8::FunctionCallbackInfo<v8::Value> &args);
   ~Buffer();
   Buffer(const Buffer &) = delete;
@@ -19,14 +20,35 @@ public:
 
   void readInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readInt16BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt16LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readInt32BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt32LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
 
   void readUInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readUInt16BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt16LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readUInt32BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt32LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+
+  // 64-bit reads return a BigInt where V8 supports it, and a Number
+  // (exact up to 2^53) otherwise.
+  void readBigInt64BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readBigInt64LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readBigUInt64BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readBigUInt64LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
 
   void readDoubleBE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readDoubleLE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readFloatBE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readFloatLE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+
+  // readBits(bitOffset, bitLength) reads up to 32 bits in network bit
+  // order.
+  void readBits(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  // readUInt16Array(offset, count, littleEndian) and its 32-bit variant
+  // return typed arrays.
+  void readUInt16Array(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt32Array(const v8::FunctionCallbackInfo<v8::Value> &args) const;
 
   void get(uint32_t index,
            const v8::PropertyCallbackInfo<v8::Value> &info) const;
@@ -36,6 +58,14 @@ public:
   std::string valueOf() const;
   const char *data(size_t offset = 0) const;
 
+  // Typed array views over the same storage, so that byte reads in
+  // dissectors are plain element loads. Both views share one ArrayBuffer
+  // per wrapper. They alias the packet bytes and must not be written to.
+  void bytes(v8::Local<v8::String> name,
+             const v8::PropertyCallbackInfo<v8::Value> &info) const;
+  void dataView(v8::Local<v8::String> name,
+                const v8::PropertyCallbackInfo<v8::Value> &info) const;
+
   void freeze();
 
 public:
@@ -43,6 +73,9 @@ public:
   static void concat(const v8::FunctionCallbackInfo<v8::Value> &args);
   static bool isBuffer(const v8::Local<v8::Value> &value);
 
+private:
+  v8::Local<v8::ArrayBuffer> arrayBuffer(v8::Local<v8::Object> holder) const;
+
 private:
   class Private;
   std::unique_ptr<Private> d;
@@ -1,6 +1,8 @@
 #include "pcap.hpp"
 #include "../packet.hpp"
 #include "../log_message.hpp"
+#include "../packet_batcher.hpp"
+#include "../slab_allocator.hpp"
 #include <mutex>
 #include <pcap.h>
 #include <signal.h>
@@ -20,9 +22,15 @@ public:
   std::string networkInterface;
   bool promiscuous = false;
   int snaplen = 2048;
+
+  PacketBatcher<std::unique_ptr<Packet>> batcher;
+  SlabAllocator allocator;
 };
 
-Pcap::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {}
+Pcap::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), batcher([ctx](std::vector<std::unique_ptr<Packet>> packets) {
+        deliverPackets(*ctx, std::move(packets));
+      }) {}
 
 Pcap::Pcap(const std::shared_ptr<Context> &ctx) : d(new Private(ctx)) {}
 
@@ -133,15 +141,17 @@ void Pcap::start() {
   }
 
   d->thread = std::thread([this]() {
-    pcap_loop(
-        d->pcap,
-        0, [](u_char *user, const struct pcap_pkthdr *h, const u_char *bytes) {
-          Pcap &self = *reinterpret_cast<Pcap *>(user);
-          if (self.d->ctx->packetCb) {
-            self.d->ctx->packetCb(
-                std::unique_ptr<Packet>(new Packet(h, bytes)));
-          }
-        }, reinterpret_cast<u_char *>(this));
+    pcap_handler handler = [](u_char *user, const struct pcap_pkthdr *h,
+                              const u_char *bytes) {
+      Pcap &self = *reinterpret_cast<Pcap *>(user);
+      self.d->batcher.push(std::unique_ptr<Packet>(
+          new Packet(h, bytes, &self.d->allocator)));
+    };
+    while (pcap_dispatch(d->pcap, -1, handler,
+                         reinterpret_cast<u_char *>(this)) >= 0) {
+      d->batcher.poll();
+    }
+    d->batcher.flush();
     {
       std::lock_guard<std::mutex> lock(d->mutex);
       pcap_close(d->pcap);
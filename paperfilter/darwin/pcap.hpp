@@ -13,6 +13,7 @@ class Pcap {
 public:
   struct Context {
     std::function<void(std::unique_ptr<Packet>)> packetCb;
+    std::function<void(std::vector<std::unique_ptr<Packet>>)> packetsCb;
     std::function<void(const LogMessage &)> logCb;
   };
   struct Device {
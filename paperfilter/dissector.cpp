@@ -5,4 +5,5 @@ Dissector::Dissector(v8::Local<v8::Object> option) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
   v8pp::get_option(isolate, option, "script", script);
   v8pp::get_option(isolate, option, "resourceName", resourceName);
+  v8pp::get_option(isolate, option, "native", native);
 }
@@ -13,6 +13,7 @@ public:
 public:
   std::string script;
   std::string resourceName;
+  std::string native;
 };
 
 #endif
@@ -1,14 +1,22 @@
 #include "dissector_thread.hpp"
 #include "packet_dispatcher.hpp"
 #include "log_message.hpp"
+#include "namespace_table.hpp"
+#include "native_dissector.hpp"
 #include "console.hpp"
 #include "layer.hpp"
+#include "layer_arena.hpp"
+#include "layer_id_table.hpp"
 #include "packet.hpp"
+#include "isolate_pool.hpp"
 #include "paper_context.hpp"
+#include "script_cache.hpp"
 #include "stream_chunk.hpp"
+#include <atomic>
 #include <cstdlib>
 #include <nan.h>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <v8.h>
 #include <v8-profiler.h>
@@ -20,37 +28,29 @@
 using namespace v8;
 
 namespace {
-class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
-public:
-  ArrayBufferAllocator() {}
-  ~ArrayBufferAllocator() {}
-
-  virtual void *Allocate(size_t size) { return calloc(1, size); }
-  virtual void *AllocateUninitialized(size_t size) { return malloc(size); }
-  virtual void Free(void *data, size_t) { free(data); }
-};
-
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
   v8::UniquePersistent<v8::Function> func;
+  std::shared_ptr<NativeDissector> native;
 };
+
+// Scripts run outside of the packet's arena, so that the layers and items
+// they construct are owned by V8 and do not point into it. A returned layer
+// is moved into an arena node; its contents stay where the script put them.
+std::shared_ptr<Layer> adoptLayer(Packet *pkt, Layer *layer) {
+  LayerArena::Scope arenaScope(pkt->arena());
+  return LayerArena::make<Layer>(std::move(*layer));
+}
 }
 
 class DissectorThread::Private {
 public:
   Private(const std::shared_ptr<DissectorSharedContext> &ctx);
   ~Private();
-  const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-          *nsMap);
 
 public:
   std::thread thread;
   std::shared_ptr<DissectorSharedContext> ctx;
-  bool closed = false;
+  std::atomic<bool> closed{false};
 };
 
 DissectorThread::Private::Private(
@@ -58,22 +58,13 @@ DissectorThread::Private::Private(
     : ctx(ctx) {
   thread = std::thread([this]() {
     DissectorSharedContext &ctx = *this->ctx;
-    v8::Isolate::CreateParams create_params;
-    create_params.array_buffer_allocator = new ArrayBufferAllocator();
-    v8::Isolate *isolate = v8::Isolate::New(create_params);
-
-    // workaround for chromium task runner
-    char dummyData[128] = {0};
-    isolate->SetData(0, dummyData);
+    v8::Isolate *isolate = IsolatePool::acquire();
 
     static const int dissectorQuota = 512;
 
     {
-      std::unique_ptr<v8::Locker> locker;
+      v8::Locker locker(isolate);
       v8::Isolate::Scope isolate_scope(isolate);
-      if (v8::Locker::IsActive()) {
-        locker.reset(new v8::Locker(isolate));
-      }
       v8::HandleScope handle_scope(isolate);
       v8pp::context ppctx(isolate);
       v8::TryCatch try_catch;
@@ -83,17 +74,30 @@ DissectorThread::Private::Private(
           v8pp::class_<Console>::create_object(isolate, ctx.logCb, "dissector");
       ppctx.set("console", console);
 
-      std::unordered_map<std::string, DissectorFunc> dissectors;
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
+      std::vector<DissectorFunc> dissectors(ctx.dissectors.size());
+
+      for (size_t index = 0; index < ctx.dissectors.size(); ++index) {
+        const Dissector &diss = ctx.dissectors[index];
+        if (!diss.native.empty()) {
+          std::shared_ptr<NativeDissector> native =
+              NativeDissector::create(diss.native);
+          if (native) {
+            dissectors[index].native = native;
+          } else if (ctx.logCb) {
+            LogMessage msg;
+            msg.message = "unknown native dissector: " + diss.native;
+            msg.domain = "dissector";
+            ctx.logCb(msg);
+          }
+          continue;
+        }
 
-      for (const Dissector &diss : ctx.dissectors) {
         v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
         ppctx.set("module", moduleObj);
 
         v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
+        Nan::MaybeLocal<Nan::BoundScript> script = ScriptCache::compile(
+            isolate, "(function(){" + diss.script + "})()", diss.resourceName);
         if (!script.IsEmpty()) {
           Nan::RunScript(script.ToLocalChecked());
           v8::Local<v8::Value> result =
@@ -120,23 +124,6 @@ DissectorThread::Private::Private(
                 LogMessage::fromMessage(try_catch.Message(), "dissector"));
           }
         } else {
-          v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
-
-          if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
-              if (ns->IsString()) {
-                stringNamespaces.push_back(
-                    v8pp::from_v8<std::string>(isolate, ns, ""));
-              } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
-              }
-            }
-          }
-
           v8::Handle<v8::Value> args[1] = {
               v8pp::json_parse(isolate, ctx.config)};
           v8::Local<v8::Object> obj = func->NewInstance(1, args);
@@ -150,9 +137,7 @@ DissectorThread::Private::Private(
                 obj->Get(v8pp::to_v8(isolate, "analyze"));
             if (!analyze.IsEmpty() && analyze->IsFunction()) {
               v8::Local<v8::Function> analyzeFunc = analyze.As<v8::Function>();
-              dissectors[diss.resourceName] = {
-                  stringNamespaces, regexNamespaces,
-                  v8::UniquePersistent<v8::Function>(isolate, analyzeFunc)};
+              dissectors[index].func.Reset(isolate, analyzeFunc);
             }
           }
         }
@@ -168,98 +153,134 @@ DissectorThread::Private::Private(
         prof->StartProfiling(profTitle, true);
       }
 
-      while (true) {
-        std::unique_lock<std::mutex> lock(ctx.mutex);
-        ctx.cond.wait(lock,
-                      [this, &ctx] { return !ctx.queue.empty() || closed; });
-        if (closed)
-          break;
-
+      std::vector<std::unique_ptr<Packet>> queued;
+      while (!closed) {
+        // Packets requested through PacketDispatcher::dissect() are already
+        // in the store and take priority over the regular queue.
         std::vector<std::shared_ptr<Packet>> packets;
-        for (int i = 0; i < dissectorQuota && !ctx.queue.empty(); ++i) {
-          packets.push_back(std::move(ctx.queue.front()));
-          ctx.queue.pop();
+        if (ctx.demandSize.load() > 0) {
+          std::lock_guard<std::mutex> lock(ctx.mutex);
+          for (int i = 0; i < dissectorQuota && !ctx.demand.empty(); ++i) {
+            packets.push_back(std::move(ctx.demand.front()));
+            ctx.demand.pop_front();
+          }
+          ctx.demandSize = ctx.demand.size();
+        }
+        size_t demanded = packets.size();
+
+        queued.clear();
+        ctx.queue->pop(&queued, dissectorQuota - packets.size());
+        for (auto &pkt : queued) {
+          packets.emplace_back(std::move(pkt));
+        }
+        if (!queued.empty() && ctx.blocked.load() > 0) {
+          std::lock_guard<std::mutex> lock(ctx.mutex);
+          ctx.spaceCond.notify_all();
+        }
+
+        if (packets.empty()) {
+          std::unique_lock<std::mutex> lock(ctx.mutex);
+          ++ctx.sleepers;
+          ctx.cond.wait(lock, [this, &ctx] {
+            return !ctx.queue->empty() || !ctx.demand.empty() || closed;
+          });
+          --ctx.sleepers;
+          if (closed)
+            break;
+          continue;
         }
-        lock.unlock();
 
         for (std::shared_ptr<Packet> &pkt : packets) {
+          std::lock_guard<std::mutex> packetLock(pkt->mutex());
+          if (pkt->dissected())
+            continue;
+
           v8::Local<v8::Object> packetObj =
               v8pp::class_<Packet>::reference_external(isolate, pkt.get());
 
-          std::unordered_map<std::string, std::shared_ptr<Layer>> layers =
-              pkt->layers();
+          // The working sets below are temporary, so they stay on the heap.
+          std::unordered_map<Atom, std::shared_ptr<Layer>> layers(
+              pkt->layers().begin(), pkt->layers().end());
 
-          std::unordered_set<std::string> usedNs;
+          std::unordered_set<Atom> usedNs;
           std::vector<std::unique_ptr<StreamChunk>> streams;
 
           while (!layers.empty()) {
-            std::unordered_map<std::string, std::shared_ptr<Layer>> nextLayers;
+            std::unordered_map<Atom, std::shared_ptr<Layer>> nextLayers;
 
             for (const auto &pair : layers) {
               usedNs.insert(pair.first);
               pair.second->setPacket(pkt);
 
-              for (const DissectorFunc *diss :
-                   findDessector(pair.first, dissectors, &nsMap)) {
-
-                v8::Local<v8::Function> analyzeFunc =
-                    v8::Local<v8::Function>::New(isolate, diss->func);
-                v8::Local<v8::Object> layerObj =
-                    v8pp::class_<Layer>::reference_external(isolate,
-                                                            pair.second.get());
-                v8::Handle<v8::Value> args[2] = {packetObj, layerObj};
-                v8::Local<v8::Value> result = analyzeFunc->Call(
-                    isolate->GetCurrentContext()->Global(), 2, args);
-
-                v8pp::class_<Layer>::unreference_external(isolate,
-                                                          pair.second.get());
+              for (size_t index : ctx.namespaces->find(pair.first)) {
+                const DissectorFunc *diss = &dissectors[index];
+                if (!diss->native && diss->func.IsEmpty())
+                  continue;
 
                 std::vector<std::shared_ptr<Layer>> childLayers;
 
-                if (result.IsEmpty()) {
-                  if (ctx.logCb) {
-                    ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
-                                                      "dissector"));
-                  }
-                } else if (result->IsArray()) {
-                  v8::Local<v8::Array> array = result.As<v8::Array>();
-                  for (uint32_t i = 0; i < array->Length(); ++i) {
-                    if (Layer *layer = v8pp::class_<Layer>::unwrap_object(
-                            isolate, array->Get(i))) {
-                      childLayers.push_back(std::make_shared<Layer>(*layer));
-                    } else if (StreamChunk *stream =
-                                   v8pp::class_<StreamChunk>::unwrap_object(
-                                       isolate, array->Get(i))) {
-                      auto chunk = std::unique_ptr<StreamChunk>(
-                          new StreamChunk(*stream));
-                      if (!chunk->layer()) {
-                        chunk->setLayer(pair.second);
+                if (diss->native) {
+                  LayerArena::Scope arenaScope(pkt->arena());
+                  diss->native->analyze(*pkt, pair.second, &childLayers,
+                                        &streams);
+                } else {
+                  v8::Local<v8::Function> analyzeFunc =
+                      v8::Local<v8::Function>::New(isolate, diss->func);
+                  v8::Local<v8::Object> layerObj =
+                      v8pp::class_<Layer>::reference_external(
+                          isolate, pair.second.get());
+                  v8::Handle<v8::Value> args[2] = {packetObj, layerObj};
+                  v8::Local<v8::Value> result = analyzeFunc->Call(
+                      isolate->GetCurrentContext()->Global(), 2, args);
+
+                  v8pp::class_<Layer>::unreference_external(isolate,
+                                                            pair.second.get());
+
+                  if (result.IsEmpty()) {
+                    if (ctx.logCb) {
+                      ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
+                                                        "dissector"));
+                    }
+                  } else if (result->IsArray()) {
+                    v8::Local<v8::Array> array = result.As<v8::Array>();
+                    for (uint32_t i = 0; i < array->Length(); ++i) {
+                      if (Layer *layer = v8pp::class_<Layer>::unwrap_object(
+                              isolate, array->Get(i))) {
+                        childLayers.push_back(adoptLayer(pkt.get(), layer));
+                      } else if (StreamChunk *stream =
+                                     v8pp::class_<StreamChunk>::unwrap_object(
+                                         isolate, array->Get(i))) {
+                        auto chunk = std::unique_ptr<StreamChunk>(
+                            new StreamChunk(*stream));
+                        if (!chunk->layer()) {
+                          chunk->setLayer(pair.second);
+                        }
+                        streams.push_back(std::move(chunk));
                       }
-                      streams.push_back(std::move(chunk));
                     }
+                  } else if (Layer *layer = v8pp::class_<Layer>::unwrap_object(
+                                 isolate, result)) {
+                    childLayers.push_back(adoptLayer(pkt.get(), layer));
+                  } else if (StreamChunk *stream =
+                                 v8pp::class_<StreamChunk>::unwrap_object(
+                                     isolate, result)) {
+                    auto chunk =
+                        std::unique_ptr<StreamChunk>(new StreamChunk(*stream));
+                    if (!chunk->layer()) {
+                      chunk->setLayer(pair.second);
+                    }
+                    streams.push_back(std::move(chunk));
                   }
-                } else if (Layer *layer = v8pp::class_<Layer>::unwrap_object(
-                               isolate, result)) {
-                  childLayers.push_back(std::make_shared<Layer>(*layer));
-                } else if (StreamChunk *stream =
-                               v8pp::class_<StreamChunk>::unwrap_object(
-                                   isolate, result)) {
-                  auto chunk =
-                      std::unique_ptr<StreamChunk>(new StreamChunk(*stream));
-                  if (!chunk->layer()) {
-                    chunk->setLayer(pair.second);
-                  }
-                  streams.push_back(std::move(chunk));
                 }
 
                 for (const auto &child : childLayers) {
-                  nextLayers[child->ns()] = child;
-                  pair.second->layers()[child->ns()] = child;
+                  nextLayers[child->nsAtom()] = child;
+                  pair.second->layers()[child->nsAtom()] = child;
                 }
               }
             }
 
-            for (const std::string &ns : usedNs) {
+            for (Atom ns : usedNs) {
               nextLayers.erase(ns);
             }
             nextLayers.swap(layers);
@@ -267,14 +288,22 @@ DissectorThread::Private::Private(
 
           v8pp::class_<Packet>::unreference_external(isolate, pkt.get());
 
+          if (ctx.layerIds)
+            pkt->setLayerMask(ctx.layerIds->mask(pkt->layers()));
+          pkt->setDissected(true);
+
           if (ctx.streamsCb)
             ctx.streamsCb(pkt->seq(), std::move(streams));
         }
 
-        if (ctx.packetCb)
+        packets.erase(packets.begin(), packets.begin() + demanded);
+        if (ctx.packetCb && !packets.empty())
           ctx.packetCb(packets);
 
-        lock.lock();
+        if (demanded > 0) {
+          std::lock_guard<std::mutex> lock(ctx.mutex);
+          ctx.dissectedCond.notify_all();
+        }
       }
 
       if (prof) {
@@ -300,7 +329,7 @@ DissectorThread::Private::Private(
       }
     }
 
-    isolate->Dispose();
+    IsolatePool::release(isolate);
   });
 }
 
@@ -314,40 +343,6 @@ DissectorThread::Private::~Private() {
     thread.join();
 }
 
-const std::vector<const DissectorFunc *> &
-DissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
-    std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-        *nsMap) {
-  static const std::vector<DissectorFunc *> null;
-
-  auto it = nsMap->find(ns);
-  if (it != nsMap->end())
-    return it->second;
-
-  std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
-      }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
-        }
-      }
-    }
-  }
-
-  return funcs;
-}
-
 DissectorThread::DissectorThread(
     const std::shared_ptr<DissectorSharedContext> &ctx)
     : d(new Private(ctx)) {}
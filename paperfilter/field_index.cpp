@@ -0,0 +1,264 @@
+#include "field_index.hpp"
+#include "filter.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "packet.hpp"
+#include "roaring_bitmap.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <unordered_map>
+#include <uv.h>
+
+namespace {
+struct FieldValue {
+  enum Kind { ABSENT, NUMBER, STRING, OTHER };
+  Kind kind = ABSENT;
+  double num = 0;
+  std::string str;
+};
+
+// Values follow the native filter semantics: a missing layer evaluates to
+// null, while a missing item falls back to layer properties and is left
+// to the filter.
+FieldValue resolve(const Packet &pkt, const std::vector<std::string> &path) {
+  FieldValue value;
+  const Layer *layer = findLayer(path[0], pkt.layers());
+  if (!layer)
+    return value;
+
+  std::shared_ptr<Item> item = layer->item(path[1]);
+  for (size_t i = 2; item && i < path.size(); ++i) {
+    item = item->item(path[i]);
+  }
+  if (!item) {
+    value.kind = FieldValue::OTHER;
+    return value;
+  }
+
+  const ItemValue &itemValue = item->value();
+  switch (itemValue.base()) {
+  case ItemValue::NUL:
+    break;
+  case ItemValue::NUMBER:
+    value.kind = std::isnan(itemValue.num()) ? FieldValue::OTHER
+                                             : FieldValue::NUMBER;
+    value.num = itemValue.num();
+    break;
+  case ItemValue::BOOLEAN:
+    value.kind = FieldValue::NUMBER;
+    value.num = itemValue.num() != 0;
+    break;
+  case ItemValue::STRING:
+    value.kind = FieldValue::STRING;
+    value.str = itemValue.str();
+    break;
+  default:
+    value.kind = FieldValue::OTHER;
+  }
+  return value;
+}
+
+bool compare(double lhs, FieldIndex::Operator op, double rhs) {
+  switch (op) {
+  case FieldIndex::LT:
+    return lhs < rhs;
+  case FieldIndex::GT:
+    return lhs > rhs;
+  case FieldIndex::LE:
+    return lhs <= rhs;
+  case FieldIndex::GE:
+    return lhs >= rhs;
+  default:
+    return lhs == rhs;
+  }
+}
+
+RoaringBitmap unite(const std::vector<const RoaringBitmap *> &bitmaps) {
+  if (bitmaps.size() == 1)
+    return *bitmaps[0];
+
+  // Merging many small posting lists pairwise would copy the result over
+  // and over, so collect the seqs first.
+  std::vector<uint32_t> seqs;
+  for (const RoaringBitmap *bitmap : bitmaps) {
+    uint64_t count = bitmap->cardinality();
+    if (count > 0) {
+      const std::vector<uint32_t> &values = bitmap->slice(0, count - 1);
+      seqs.insert(seqs.end(), values.begin(), values.end());
+    }
+  }
+  std::sort(seqs.begin(), seqs.end());
+
+  RoaringBitmap result;
+  for (uint32_t seq : seqs) {
+    result.add(seq);
+  }
+  return result;
+}
+}
+
+class FieldIndex::Private {
+public:
+  struct Field {
+    std::vector<std::string> path;
+    RoaringBitmap absent;
+    RoaringBitmap other;
+    RoaringBitmap strings;
+    std::map<double, RoaringBitmap> numberPostings;
+    std::unordered_map<std::string, RoaringBitmap> stringPostings;
+  };
+
+public:
+  Private();
+  ~Private();
+
+public:
+  uv_rwlock_t rwlock;
+  std::vector<Field> fields;
+  std::unordered_map<std::string, size_t> fieldIds;
+  RoaringBitmap indexed;
+};
+
+FieldIndex::Private::Private() { uv_rwlock_init(&rwlock); }
+
+FieldIndex::Private::~Private() { uv_rwlock_destroy(&rwlock); }
+
+FieldIndex::FieldIndex(const std::vector<std::string> &fields)
+    : d(new Private()) {
+  for (const std::string &name : fields) {
+    std::vector<std::string> path;
+    size_t begin = 0;
+    while (true) {
+      size_t end = name.find('.', begin);
+      path.push_back(name.substr(begin, end - begin));
+      if (end == std::string::npos)
+        break;
+      begin = end + 1;
+    }
+    bool valid = path.size() >= 2 &&
+                 std::find(path.begin(), path.end(), "") == path.end();
+    if (valid && d->fieldIds.emplace(name, d->fields.size()).second) {
+      d->fields.emplace_back();
+      d->fields.back().path = path;
+    }
+  }
+}
+
+FieldIndex::~FieldIndex() {}
+
+bool FieldIndex::empty() const { return d->fields.empty(); }
+
+void FieldIndex::insert(const std::vector<std::shared_ptr<Packet>> &packets) {
+  if (d->fields.empty())
+    return;
+
+  std::vector<std::pair<uint32_t, std::vector<FieldValue>>> entries;
+  entries.reserve(packets.size());
+  for (const auto &pkt : packets) {
+    if (!pkt || !pkt->dissected())
+      continue;
+    std::vector<FieldValue> values;
+    values.reserve(d->fields.size());
+    for (const Private::Field &field : d->fields) {
+      values.push_back(resolve(*pkt, field.path));
+    }
+    entries.emplace_back(pkt->seq(), std::move(values));
+  }
+  if (entries.empty())
+    return;
+
+  uv_rwlock_wrlock(&d->rwlock);
+  for (const auto &entry : entries) {
+    uint32_t seq = entry.first;
+    for (size_t i = 0; i < d->fields.size(); ++i) {
+      Private::Field &field = d->fields[i];
+      const FieldValue &value = entry.second[i];
+      switch (value.kind) {
+      case FieldValue::ABSENT:
+        field.absent.add(seq);
+        break;
+      case FieldValue::NUMBER:
+        field.numberPostings[value.num].add(seq);
+        break;
+      case FieldValue::STRING:
+        field.strings.add(seq);
+        field.stringPostings[value.str].add(seq);
+        break;
+      default:
+        field.other.add(seq);
+      }
+    }
+    d->indexed.add(seq);
+  }
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+uint64_t FieldIndex::size() const {
+  uv_rwlock_rdlock(&d->rwlock);
+  uint64_t size = d->indexed.cardinality();
+  uv_rwlock_rdunlock(&d->rwlock);
+  return size;
+}
+
+bool FieldIndex::query(const Predicate &pred, RoaringBitmap *matched,
+                       RoaringBitmap *resolved) const {
+  auto it = d->fieldIds.find(pred.field);
+  if (it == d->fieldIds.end())
+    return false;
+
+  // Relational operators convert strings to numbers, which the string
+  // postings do not capture.
+  bool equality = pred.op == EQ || pred.op == NE;
+  if (pred.string && !equality)
+    return false;
+
+  uv_rwlock_rdlock(&d->rwlock);
+  const Private::Field &field = d->fields[it->second];
+  const auto &numbers = field.numberPostings;
+
+  // String values compared to a number are left to the filter.
+  *resolved = d->indexed.andNot(field.other);
+  if (!pred.string)
+    *resolved = resolved->andNot(field.strings);
+
+  std::vector<const RoaringBitmap *> postings;
+  if (pred.string) {
+    auto str = field.stringPostings.find(pred.str);
+    if (str != field.stringPostings.end())
+      postings.push_back(&str->second);
+  }
+  if (!std::isnan(pred.num)) {
+    if (equality) {
+      auto num = numbers.find(pred.num);
+      if (num != numbers.end())
+        postings.push_back(&num->second);
+    } else {
+      auto begin = numbers.begin();
+      auto end = numbers.end();
+      if (pred.op == LT) {
+        end = numbers.lower_bound(pred.num);
+      } else if (pred.op == LE) {
+        end = numbers.upper_bound(pred.num);
+      } else if (pred.op == GT) {
+        begin = numbers.upper_bound(pred.num);
+      } else {
+        begin = numbers.lower_bound(pred.num);
+      }
+      for (; begin != end; ++begin) {
+        postings.push_back(&begin->second);
+      }
+
+      // A missing layer evaluates to null, which compares as 0.
+      if (compare(0, pred.op, pred.num))
+        postings.push_back(&field.absent);
+    }
+  }
+
+  *matched = postings.empty() ? RoaringBitmap() : unite(postings);
+  if (pred.op == NE)
+    *matched = resolved->andNot(*matched);
+  uv_rwlock_rdunlock(&d->rwlock);
+  return true;
+}
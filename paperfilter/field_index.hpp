@@ -0,0 +1,50 @@
+#ifndef FIELD_INDEX_HPP
+#define FIELD_INDEX_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Packet;
+class RoaringBitmap;
+
+// FieldIndex records the values of configured item paths (e.g.
+// "tcp.dstPort") into per-value posting lists as packets are dissected,
+// so that simple comparisons can be answered without visiting packets.
+class FieldIndex {
+public:
+  enum Operator { EQ, NE, LT, GT, LE, GE };
+
+  // Compares |field| with a string literal if |string| is set and with
+  // |num| otherwise. For string literals |num| holds their numeric value.
+  struct Predicate {
+    std::string field;
+    Operator op = EQ;
+    bool string = false;
+    std::string str;
+    double num = 0;
+  };
+
+public:
+  explicit FieldIndex(const std::vector<std::string> &fields);
+  ~FieldIndex();
+  FieldIndex(const FieldIndex &) = delete;
+  FieldIndex &operator=(const FieldIndex &) = delete;
+
+  bool empty() const;
+  void insert(const std::vector<std::shared_ptr<Packet>> &packets);
+  uint64_t size() const;
+
+  // Sets |resolved| to the indexed seqs for which |pred| can be decided
+  // from the index, and |matched| to those among them for which it holds.
+  // Returns false if the field is not indexed.
+  bool query(const Predicate &pred, RoaringBitmap *matched,
+             RoaringBitmap *resolved) const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
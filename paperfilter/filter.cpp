@@ -3,6 +3,7 @@
 #include "packet.hpp"
 #include "item.hpp"
 #include "item_value.hpp"
+#include <algorithm>
 #include <json11.hpp>
 #include <nan.h>
 #include <v8pp/class.hpp>
@@ -30,6 +31,46 @@ v8::Local<v8::Value> fetchValue(v8::Local<v8::Value> value) {
 v8::Local<v8::Value> fetchValue(const FilterResult &result) {
   return fetchValue(result.value);
 }
+
+// Constants are created once at compile time and shared by every
+// evaluation of the filter program.
+template <class T>
+using SharedPersistent = std::shared_ptr<v8::UniquePersistent<T>>;
+
+template <class T>
+SharedPersistent<T> makePersistent(v8::Isolate *isolate, v8::Local<T> value) {
+  return std::make_shared<v8::UniquePersistent<T>>(isolate, value);
+}
+
+
+void conjunctionTerms(const json11::Json &json,
+                      std::vector<json11::Json> *terms) {
+  if (json["type"].string_value() == "LogicalExpression" &&
+      json["operator"].string_value() == "&&") {
+    conjunctionTerms(json["left"], terms);
+    conjunctionTerms(json["right"], terms);
+  } else {
+    terms->push_back(json);
+  }
+}
+}
+
+const Layer *findLayer(Atom id, const LayerMap &layers) {
+  for (const auto &pair : layers) {
+    if (pair.second->idAtom() == id) {
+      return pair.second.get();
+    }
+  }
+  for (const auto &pair : layers) {
+    if (const Layer *layer = findLayer(id, pair.second->layers())) {
+      return layer;
+    }
+  }
+  return nullptr;
+}
+
+const Layer *findLayer(const std::string &id, const LayerMap &layers) {
+  return findLayer(Atom::find(id), layers);
 }
 
 FilterFunc makeFilter(const json11::Json &json) {
@@ -41,26 +82,31 @@ FilterFunc makeFilter(const json11::Json &json) {
     const json11::Json &property = json["property"];
     const std::string &propertyType = property["type"].string_value();
     FilterFunc propertyFunc;
+    std::string propertyName;
+    SharedPersistent<v8::String> propertyKey;
 
     if (propertyType == "Identifier") {
-      const std::string &name = property["name"].string_value();
-      propertyFunc = [isolate, name](Packet *) {
-        return FilterResult(v8pp::to_v8(isolate, name));
-      };
+      propertyName = property["name"].string_value();
+      propertyKey = makePersistent(isolate, v8pp::to_v8(isolate, propertyName));
     } else {
       propertyFunc = makeFilter(property);
     }
 
     const FilterFunc &objectFunc = makeFilter(json["object"]);
 
-    return FilterFunc([isolate, objectFunc,
-                       propertyFunc](Packet *pkt) -> FilterResult {
+    return FilterFunc([isolate, objectFunc, propertyFunc, propertyName,
+                       propertyKey](Packet *pkt) -> FilterResult {
       v8::Local<v8::Value> value = objectFunc(pkt).value;
-      v8::Local<v8::Value> property = propertyFunc(pkt).value;
       v8::Local<v8::Value> result;
 
-      const std::string &name =
-          v8pp::from_v8<std::string>(isolate, property, "");
+      std::string name = propertyName;
+      v8::Local<v8::Value> key;
+      if (propertyKey) {
+        key = v8::Local<v8::String>::New(isolate, *propertyKey);
+      } else {
+        key = propertyFunc(pkt).value;
+        name = v8pp::from_v8<std::string>(isolate, key, "");
+      }
       if (name.empty())
         return result;
 
@@ -84,7 +130,6 @@ FilterFunc makeFilter(const json11::Json &json) {
         }
         if (value->IsObject()) {
           v8::Local<v8::Object> object = value.As<v8::Object>();
-          v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
           if (object->Has(key)) {
             result = object->Get(key);
           }
@@ -145,19 +190,19 @@ FilterFunc makeFilter(const json11::Json &json) {
     } else if (op == "-") {
       return FilterFunc([isolate, lf, rf](Packet *pkt) {
         return FilterResult(
-            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() +
+            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() -
                                          fetchValue(rf(pkt))->NumberValue()));
       });
     } else if (op == "*") {
       return FilterFunc([isolate, lf, rf](Packet *pkt) {
         return FilterResult(
-            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() +
+            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() *
                                          fetchValue(rf(pkt))->NumberValue()));
       });
     } else if (op == "/") {
       return FilterFunc([isolate, lf, rf](Packet *pkt) {
         return FilterResult(
-            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() +
+            v8::Number::New(isolate, fetchValue(lf(pkt))->NumberValue() /
                                          fetchValue(rf(pkt))->NumberValue()));
       });
     } else if (op == "%") {
@@ -199,26 +244,24 @@ FilterFunc makeFilter(const json11::Json &json) {
     }
   } else if (type == "Literal") {
     const json11::Json &regex = json["regex"];
+    v8::Local<v8::Value> value = v8::Null(isolate);
     if (regex.is_object()) {
-      const std::string &value = json["raw"].string_value();
-      return FilterFunc([isolate, value](Packet *pkt) -> v8::Local<v8::Value> {
-        Nan::MaybeLocal<Nan::BoundScript> script =
-            Nan::CompileScript(v8pp::to_v8(isolate, value));
-        if (!script.IsEmpty()) {
-          Nan::MaybeLocal<v8::Value> result =
-              Nan::RunScript(script.ToLocalChecked());
-          if (!result.IsEmpty()) {
-            return result.ToLocalChecked();
-          }
+      Nan::MaybeLocal<Nan::BoundScript> script =
+          Nan::CompileScript(v8pp::to_v8(isolate, json["raw"].string_value()));
+      if (!script.IsEmpty()) {
+        Nan::MaybeLocal<v8::Value> result =
+            Nan::RunScript(script.ToLocalChecked());
+        if (!result.IsEmpty()) {
+          value = result.ToLocalChecked();
         }
-        return v8::Null(isolate);
-      });
+      }
     } else {
-      const std::string &value = json["value"].dump();
-      return FilterFunc([isolate, value](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::json_parse(isolate, value);
-      });
+      value = v8pp::json_parse(isolate, json["value"].dump());
     }
+    const SharedPersistent<v8::Value> &literal = makePersistent(isolate, value);
+    return FilterFunc([isolate, literal](Packet *pkt) {
+      return FilterResult(v8::Local<v8::Value>::New(isolate, *literal));
+    });
 
   } else if (type == "LogicalExpression") {
     const std::string &op = json["operator"].string_value();
@@ -291,9 +334,10 @@ FilterFunc makeFilter(const json11::Json &json) {
     });
   } else if (type == "Identifier") {
     const std::string &name = json["name"].string_value();
-    return FilterFunc([isolate, name](Packet *pkt) {
-
-      v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
+    const SharedPersistent<v8::String> &nameKey =
+        makePersistent(isolate, v8pp::to_v8(isolate, name));
+    return FilterFunc([isolate, name, nameKey](Packet *pkt) {
+      v8::Local<v8::String> key = v8::Local<v8::String>::New(isolate, *nameKey);
       v8::Local<v8::Object> pktObject =
           v8pp::class_<Packet>::find_object(isolate, pkt);
       if (pktObject.IsEmpty()) {
@@ -303,37 +347,14 @@ FilterFunc makeFilter(const json11::Json &json) {
         return FilterResult(pktObject->Get(key));
       }
 
-      std::function<std::shared_ptr<Layer>(
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>> &)>
-          findLayer;
-      findLayer = [&findLayer](
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>>
-              &layers) {
-        for (const auto &pair : layers) {
-          if (pair.second->id() == name) {
-            return pair.second;
-          }
-        }
-        for (const auto &pair : layers) {
-          const std::shared_ptr<Layer> &layer =
-              findLayer(name, pair.second->layers());
-          if (layer) {
-            return layer;
-          }
-        }
-        return std::shared_ptr<Layer>();
-      };
-      if (const std::shared_ptr<Layer> &layer =
-              findLayer(name, pkt->layers())) {
+      if (const Layer *layer = findLayer(name, pkt->layers())) {
         v8::Local<v8::Object> layerObject =
-            v8pp::class_<Layer>::find_object(isolate, layer.get());
+            v8pp::class_<Layer>::find_object(isolate, layer);
         if (!layerObject.IsEmpty()) {
           return FilterResult(layerObject);
         }
-        return FilterResult(
-            v8pp::class_<Layer>::reference_external(isolate, layer.get()));
+        return FilterResult(v8pp::class_<Layer>::reference_external(
+            isolate, const_cast<Layer *>(layer)));
       }
       if (name == "$") {
         return FilterResult(pktObject);
@@ -353,8 +374,26 @@ FilterFunc makeFilter(const json11::Json &json) {
 FilterFunc makeFilter(const std::string &jsonstr) {
   std::string err;
   json11::Json json = json11::Json::parse(jsonstr, err);
-  return FilterFunc([json](Packet *pkt) -> v8::Local<v8::Value> {
-    return fetchValue(makeFilter(json)(pkt));
+  const FilterFunc &root = makeFilter(json);
+  return FilterFunc([root](Packet *pkt) -> v8::Local<v8::Value> {
+    return fetchValue(root(pkt));
   });
-  return makeFilter(json);
+}
+
+bool refinesFilter(const std::string &jsonstr, const std::string &basestr) {
+  std::string err;
+  const json11::Json &json = json11::Json::parse(jsonstr, err);
+  const json11::Json &base = json11::Json::parse(basestr, err);
+  if (!json.is_object() || !base.is_object())
+    return false;
+
+  std::vector<json11::Json> terms;
+  std::vector<json11::Json> baseTerms;
+  conjunctionTerms(json, &terms);
+  conjunctionTerms(base, &baseTerms);
+  for (const json11::Json &term : baseTerms) {
+    if (std::find(terms.begin(), terms.end(), term) == terms.end())
+      return false;
+  }
+  return true;
 }
@@ -1,11 +1,19 @@
 #ifndef FILTER_HPP
 #define FILTER_HPP
 
+#include "layer.hpp"
 #include <v8.h>
 #include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 class Packet;
 
+namespace json11 {
+class Json;
+}
+
 struct FilterResult {
   FilterResult(v8::Local<v8::Value> value,
                v8::Local<v8::Value> parent = v8::Local<v8::Value>())
@@ -16,6 +24,14 @@ struct FilterResult {
 
 typedef std::function<FilterResult(Packet *)> FilterFunc;
 
+FilterFunc makeFilter(const json11::Json &json);
 FilterFunc makeFilter(const std::string &jsonstr);
 
+// Returns true if every packet matching |jsonstr| also matches |basestr|,
+// i.e. |jsonstr| is a conjunction that contains all terms of |basestr|.
+bool refinesFilter(const std::string &jsonstr, const std::string &basestr);
+
+const Layer *findLayer(Atom id, const LayerMap &layers);
+const Layer *findLayer(const std::string &id, const LayerMap &layers);
+
 #endif
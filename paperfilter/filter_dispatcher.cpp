@@ -0,0 +1,131 @@
+#include "filter_dispatcher.hpp"
+#include "filter.hpp"
+#include "filter_thread.hpp"
+#include "packet_store.hpp"
+#include <deque>
+
+namespace {
+const size_t recentTaskLimit = 8;
+}
+
+class FilterDispatcher::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+
+public:
+  std::shared_ptr<FilterSharedContext> filterCtx;
+  std::vector<std::unique_ptr<FilterThread>> filterThreads;
+  std::deque<std::shared_ptr<FilterTask>> recentTasks;
+  int threads;
+  int storeHandlerId;
+};
+
+FilterDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
+    : filterCtx(std::make_shared<FilterSharedContext>()),
+      threads(ctx->threads) {
+  filterCtx->store = ctx->store;
+  filterCtx->index = ctx->index;
+  filterCtx->layerIds = ctx->layerIds;
+  filterCtx->native = ctx->native;
+  filterCtx->logCb = ctx->logCb;
+  filterCtx->dissectCb = ctx->dissectCb;
+
+  storeHandlerId = filterCtx->store->addHandler(
+      [this](uint32_t maxSeq) { filterCtx->cond.notify_all(); });
+}
+
+FilterDispatcher::Private::~Private() {
+  filterCtx->store->removeHandler(storeHandlerId);
+  filterThreads.clear();
+}
+
+FilterDispatcher::FilterDispatcher(const std::shared_ptr<Context> &ctx)
+    : d(new Private(ctx)) {}
+
+FilterDispatcher::~FilterDispatcher() {}
+
+std::shared_ptr<FilterTask>
+FilterDispatcher::findTask(const std::string &filter) const {
+  std::lock_guard<std::mutex> lock(d->filterCtx->mutex);
+  for (const auto &pair : d->filterCtx->tasks) {
+    if (pair.second->filter == filter)
+      return pair.second;
+  }
+  for (const auto &task : d->recentTasks) {
+    if (task->filter == filter)
+      return task;
+  }
+  return std::shared_ptr<FilterTask>();
+}
+
+void FilterDispatcher::setTask(const std::string &name,
+                               const std::shared_ptr<FilterTask> &task) {
+  {
+    std::lock_guard<std::mutex> lock(d->filterCtx->mutex);
+
+    // A fresh task that narrows an active or recent filter only has to
+    // re-check the packets that filter has matched so far.
+    if (task->maxSeq == 0) {
+      const FilterTask *base = nullptr;
+      auto consider = [&task, &base](const std::shared_ptr<FilterTask> &t) {
+        if (t != task && t->packets.maxSeq() > 0 &&
+            (!base || t->packets.maxSeq() > base->packets.maxSeq()) &&
+            refinesFilter(task->filter, t->filter)) {
+          base = t.get();
+        }
+      };
+      for (const auto &pair : d->filterCtx->tasks) {
+        consider(pair.second);
+      }
+      for (const auto &recent : d->recentTasks) {
+        consider(recent);
+      }
+      if (base) {
+        task->candidates = base->packets.matches(&task->candidateMaxSeq);
+      }
+    }
+
+    d->filterCtx->tasks[name] = task;
+  }
+
+  // The pool is started on demand and then outlives individual filters,
+  // so replacing a filter reuses the workers' isolates.
+  if (d->filterThreads.empty()) {
+    for (int i = 0; i < d->threads; ++i) {
+      d->filterThreads.emplace_back(new FilterThread(d->filterCtx));
+    }
+  }
+  d->filterCtx->cond.notify_all();
+}
+
+void FilterDispatcher::removeTask(const std::string &name) {
+  std::lock_guard<std::mutex> lock(d->filterCtx->mutex);
+  auto it = d->filterCtx->tasks.find(name);
+  if (it == d->filterCtx->tasks.end())
+    return;
+
+  // Keep the results of recently replaced filters so that reapplying
+  // one resumes from where it stopped.
+  const std::shared_ptr<FilterTask> task = it->second;
+  d->filterCtx->tasks.erase(it);
+  for (auto recent = d->recentTasks.begin(); recent != d->recentTasks.end();
+       ++recent) {
+    if ((*recent)->filter == task->filter) {
+      d->recentTasks.erase(recent);
+      break;
+    }
+  }
+  d->recentTasks.push_front(task);
+  if (d->recentTasks.size() > recentTaskLimit)
+    d->recentTasks.pop_back();
+}
+
+void FilterDispatcher::setViewport(uint32_t start, uint32_t end) {
+  {
+    std::lock_guard<std::mutex> lock(d->filterCtx->mutex);
+    d->filterCtx->viewStart = start;
+    d->filterCtx->viewEnd = end;
+  }
+  d->filterCtx->cond.notify_all();
+}
@@ -0,0 +1,45 @@
+#ifndef FILTER_DISPATCHER_HPP
+#define FILTER_DISPATCHER_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FieldIndex;
+class LayerIdTable;
+class Packet;
+class PacketStore;
+struct FilterTask;
+struct LogMessage;
+
+class FilterDispatcher {
+public:
+  struct Context {
+    int threads;
+    PacketStore *store = nullptr;
+    std::shared_ptr<FieldIndex> index;
+    std::shared_ptr<LayerIdTable> layerIds;
+    bool native = true;
+    std::function<void(const LogMessage &)> logCb;
+    std::function<void(const std::vector<std::shared_ptr<Packet>> &)>
+        dissectCb;
+  };
+
+public:
+  FilterDispatcher(const std::shared_ptr<Context> &ctx);
+  ~FilterDispatcher();
+  FilterDispatcher(const FilterDispatcher &) = delete;
+  FilterDispatcher &operator=(const FilterDispatcher &) = delete;
+  std::shared_ptr<FilterTask> findTask(const std::string &filter) const;
+  void setTask(const std::string &name,
+               const std::shared_ptr<FilterTask> &task);
+  void removeTask(const std::string &name);
+  void setViewport(uint32_t start, uint32_t end);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
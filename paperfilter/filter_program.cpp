@@ -0,0 +1,835 @@
+#include "filter_program.hpp"
+#include "buffer.hpp"
+#include "field_index.hpp"
+#include "filter.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "layer_id_table.hpp"
+#include "packet.hpp"
+#include "roaring_bitmap.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <json11.hpp>
+#include <limits>
+#include <unordered_map>
+#include <v8pp/class.hpp>
+#include <v8pp/convert.hpp>
+#include <vector>
+
+namespace {
+enum Opcode {
+  OP_CONST,
+  OP_PACKET,
+  OP_LAYER,
+  OP_GLOBAL,
+  OP_MEMBER,
+  OP_V8,
+  OP_POP,
+  OP_JUMP,
+  OP_JUMP_IF_FALSE,
+  OP_JUMP_IF_TRUE_KEEP,
+  OP_JUMP_IF_FALSE_KEEP,
+  OP_POS,
+  OP_NEG,
+  OP_NOT,
+  OP_BIT_NOT,
+  // Binary operators from here on.
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_MOD,
+  OP_BIT_AND,
+  OP_BIT_OR,
+  OP_BIT_XOR,
+  OP_SHR,
+  OP_SHL,
+  OP_GT,
+  OP_LT,
+  OP_GE,
+  OP_LE,
+  OP_EQ,
+  OP_NE
+};
+
+struct Instruction {
+  Instruction(Opcode op, uint32_t arg = 0) : op(op), arg(arg) {}
+  Opcode op;
+  uint32_t arg;
+};
+
+struct Value {
+  enum Kind { NUL, NUMBER, BOOLEAN, STRING, BUFFER, PACKET, LAYER, ITEM };
+  Kind kind = NUL;
+  double num = 0;
+  std::string str;
+  const Layer *layer = nullptr;
+  const Item *item = nullptr;
+};
+
+const std::unordered_map<std::string, Opcode> binaryOps = {
+    {"+", OP_ADD},     {"-", OP_SUB},     {"*", OP_MUL},    {"/", OP_DIV},
+    {"%", OP_MOD},     {"&", OP_BIT_AND}, {"|", OP_BIT_OR}, {"^", OP_BIT_XOR},
+    {">>", OP_SHR},    {"<<", OP_SHL},    {">", OP_GT},     {"<", OP_LT},
+    {">=", OP_GE},     {"<=", OP_LE},     {"==", OP_EQ},    {"!=", OP_NE}};
+
+const std::unordered_map<std::string, Opcode> unaryOps = {
+    {"+", OP_POS}, {"-", OP_NEG}, {"!", OP_NOT}, {"~", OP_BIT_NOT}};
+
+const std::unordered_map<std::string, FieldIndex::Operator> indexOps = {
+    {"==", FieldIndex::EQ}, {"!=", FieldIndex::NE}, {"<", FieldIndex::LT},
+    {">", FieldIndex::GT},  {"<=", FieldIndex::LE}, {">=", FieldIndex::GE}};
+
+void setNumber(Value *value, double num) {
+  value->kind = Value::NUMBER;
+  value->num = num;
+}
+
+void setBoolean(Value *value, bool b) {
+  value->kind = Value::BOOLEAN;
+  value->num = b;
+}
+
+void setString(Value *value, const std::string &str) {
+  value->kind = Value::STRING;
+  value->str = str;
+}
+
+double stringToNumber(const std::string &str) {
+  const char *space = " \t\n\v\f\r";
+  size_t begin = str.find_first_not_of(space);
+  if (begin == std::string::npos)
+    return 0;
+  const std::string &s =
+      str.substr(begin, str.find_last_not_of(space) - begin + 1);
+
+  if (s == "Infinity" || s == "+Infinity")
+    return std::numeric_limits<double>::infinity();
+  if (s == "-Infinity")
+    return -std::numeric_limits<double>::infinity();
+
+  int radix = 10;
+  if (s.size() > 2 && s[0] == '0') {
+    switch (s[1]) {
+    case 'x':
+    case 'X':
+      radix = 16;
+      break;
+    case 'o':
+    case 'O':
+      radix = 8;
+      break;
+    case 'b':
+    case 'B':
+      radix = 2;
+      break;
+    default:;
+    }
+  }
+
+  char *end = nullptr;
+  if (radix != 10) {
+    double num = std::strtoull(s.c_str() + 2, &end, radix);
+    return *end == '\0' ? num : std::numeric_limits<double>::quiet_NaN();
+  }
+  if (s.find_first_not_of("0123456789.eE+-") != std::string::npos)
+    return std::numeric_limits<double>::quiet_NaN();
+  double num = std::strtod(s.c_str(), &end);
+  return *end == '\0' ? num : std::numeric_limits<double>::quiet_NaN();
+}
+
+int32_t toInt32(double num) {
+  if (!std::isfinite(num))
+    return 0;
+  double mod = std::fmod(std::trunc(num), 4294967296.0);
+  if (mod < 0)
+    mod += 4294967296.0;
+  return static_cast<int32_t>(static_cast<uint32_t>(mod));
+}
+
+size_t utf16Length(const std::string &str) {
+  size_t length = 0;
+  for (unsigned char c : str) {
+    if ((c & 0xc0) != 0x80)
+      length += (c >= 0xf0) ? 2 : 1;
+  }
+  return length;
+}
+
+bool requiresV8(const json11::Json &json) {
+  const std::string &type = json["type"].string_value();
+  if (type == "CallExpression") {
+    return true;
+  } else if (type == "Literal") {
+    return json["regex"].is_object();
+  } else if (type == "Identifier") {
+    const std::string &name = json["name"].string_value();
+    return name == "payload" || name == "layers";
+  } else if (type == "MemberExpression") {
+    const json11::Json &property = json["property"];
+    if (property["type"].string_value() != "Identifier" &&
+        !(property["type"].string_value() == "Literal" &&
+          property["value"].is_string()))
+      return true;
+    return requiresV8(json["object"]);
+  } else if (type == "BinaryExpression" || type == "LogicalExpression") {
+    return requiresV8(json["left"]) || requiresV8(json["right"]);
+  } else if (type == "UnaryExpression") {
+    return requiresV8(json["argument"]);
+  } else if (type == "ConditionalExpression") {
+    return requiresV8(json["test"]) || requiresV8(json["consequent"]) ||
+           requiresV8(json["alternate"]);
+  }
+  return false;
+}
+}
+
+class FilterProgram::Private {
+public:
+  Private();
+  void compile(const json11::Json &json);
+  void collect(const json11::Json &json);
+  bool predicate(const json11::Json &json, FieldIndex::Predicate *pred);
+  bool fieldPath(const json11::Json &json, std::string *field);
+  uint32_t emit(Opcode op, uint32_t arg = 0);
+  uint32_t intern(const std::string &name);
+  void patch(uint32_t index);
+
+  void fetch(Value *value);
+  bool truthy(Value *value);
+  double number(Value *value);
+  bool equals(Value *lhs, Value *rhs);
+  void member(Value *value, uint32_t index);
+  void packetProperty(Value *value, const std::string &name);
+  void layerProperty(Value *value, const std::string &name);
+  void convert(Value *value, v8::Local<v8::Value> result);
+
+public:
+  v8::Isolate *isolate;
+  std::vector<Instruction> code;
+  std::vector<Value> constants;
+  std::vector<std::string> names;
+  std::vector<Atom> atoms;
+  std::vector<FilterFunc> subtrees;
+
+  // Field comparisons of the top-level conjunction; |conjunctive| is false
+  // if it also has other terms.
+  std::vector<FieldIndex::Predicate> predicates;
+  bool conjunctive = true;
+
+  // Layer ids that every matching packet must contain.
+  std::vector<std::string> requiredLayers;
+  uint64_t requiredMask = 0;
+
+  Packet *pkt = nullptr;
+  bool fallback = false;
+  std::vector<Value> stack;
+};
+
+FilterProgram::Private::Private() : isolate(v8::Isolate::GetCurrent()) {}
+
+uint32_t FilterProgram::Private::emit(Opcode op, uint32_t arg) {
+  code.emplace_back(op, arg);
+  return code.size() - 1;
+}
+
+uint32_t FilterProgram::Private::intern(const std::string &name) {
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i] == name)
+      return i;
+  }
+  names.push_back(name);
+  atoms.push_back(Atom(name));
+  return names.size() - 1;
+}
+
+void FilterProgram::Private::patch(uint32_t index) {
+  code[index].arg = code.size();
+}
+
+void FilterProgram::Private::compile(const json11::Json &json) {
+  if (requiresV8(json)) {
+    subtrees.push_back(makeFilter(json));
+    emit(OP_V8, subtrees.size() - 1);
+    return;
+  }
+
+  const std::string &type = json["type"].string_value();
+  Value constant;
+
+  if (type == "MemberExpression") {
+    const json11::Json &property = json["property"];
+    const std::string &name = property["type"].string_value() == "Identifier"
+                                  ? property["name"].string_value()
+                                  : property["value"].string_value();
+    compile(json["object"]);
+    emit(OP_MEMBER, intern(name));
+    return;
+  } else if (type == "BinaryExpression") {
+    auto it = binaryOps.find(json["operator"].string_value());
+    if (it != binaryOps.end()) {
+      compile(json["left"]);
+      compile(json["right"]);
+      emit(it->second);
+      return;
+    }
+  } else if (type == "Literal") {
+    const json11::Json &value = json["value"];
+    if (value.is_number()) {
+      setNumber(&constant, value.number_value());
+    } else if (value.is_bool()) {
+      setBoolean(&constant, value.bool_value());
+    } else if (value.is_string()) {
+      setString(&constant, value.string_value());
+    }
+  } else if (type == "LogicalExpression") {
+    compile(json["left"]);
+    uint32_t jump = emit(json["operator"].string_value() == "||"
+                             ? OP_JUMP_IF_TRUE_KEEP
+                             : OP_JUMP_IF_FALSE_KEEP);
+    emit(OP_POP);
+    compile(json["right"]);
+    patch(jump);
+    return;
+  } else if (type == "UnaryExpression") {
+    auto it = unaryOps.find(json["operator"].string_value());
+    if (it != unaryOps.end()) {
+      compile(json["argument"]);
+      emit(it->second);
+      return;
+    }
+  } else if (type == "ConditionalExpression") {
+    compile(json["test"]);
+    uint32_t alternate = emit(OP_JUMP_IF_FALSE);
+    compile(json["consequent"]);
+    uint32_t end = emit(OP_JUMP);
+    patch(alternate);
+    compile(json["alternate"]);
+    patch(end);
+    return;
+  } else if (type == "Identifier") {
+    const std::string &name = json["name"].string_value();
+    if (name == "$") {
+      emit(OP_PACKET);
+    } else if (name == "seq" || name == "ts_sec" || name == "ts_nsec" ||
+               name == "length" || name == "confidence") {
+      emit(OP_PACKET);
+      emit(OP_MEMBER, intern(name));
+    } else {
+      // Identifiers that name a global only resolve natively when a
+      // layer with the same id exists.
+      v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
+      bool isGlobal = global->Has(v8pp::to_v8(isolate, name));
+      emit(isGlobal ? OP_GLOBAL : OP_LAYER, intern(name));
+    }
+    return;
+  }
+
+  constants.push_back(constant);
+  emit(OP_CONST, constants.size() - 1);
+}
+
+void FilterProgram::Private::collect(const json11::Json &json) {
+  if (json["type"].string_value() == "LogicalExpression" &&
+      json["operator"].string_value() == "&&") {
+    collect(json["left"]);
+    collect(json["right"]);
+    return;
+  }
+
+  FieldIndex::Predicate pred;
+  std::string field;
+  if (predicate(json, &pred)) {
+    predicates.push_back(pred);
+    if (pred.op == FieldIndex::EQ)
+      field = pred.field;
+  } else {
+    conjunctive = false;
+    fieldPath(json, &field);
+  }
+
+  // A bare path or an equality is false when its layer is missing.
+  if (!field.empty())
+    requiredLayers.push_back(field.substr(0, field.find('.')));
+}
+
+bool FilterProgram::Private::predicate(const json11::Json &json,
+                                       FieldIndex::Predicate *pred) {
+  if (json["type"].string_value() != "BinaryExpression")
+    return false;
+  auto it = indexOps.find(json["operator"].string_value());
+  if (it == indexOps.end())
+    return false;
+  pred->op = it->second;
+
+  json11::Json literal = json["right"];
+  if (!fieldPath(json["left"], &pred->field)) {
+    if (!fieldPath(json["right"], &pred->field))
+      return false;
+    literal = json["left"];
+    const FieldIndex::Operator swapped[] = {FieldIndex::EQ, FieldIndex::NE,
+                                            FieldIndex::GT, FieldIndex::LT,
+                                            FieldIndex::GE, FieldIndex::LE};
+    pred->op = swapped[pred->op];
+  }
+
+  double sign = 1;
+  if (literal["type"].string_value() == "UnaryExpression" &&
+      literal["operator"].string_value() == "-" &&
+      literal["argument"]["value"].is_number()) {
+    sign = -1;
+    literal = literal["argument"];
+  }
+  if (literal["type"].string_value() != "Literal")
+    return false;
+
+  const json11::Json &value = literal["value"];
+  if (value.is_number()) {
+    pred->num = sign * value.number_value();
+  } else if (value.is_bool()) {
+    pred->num = value.bool_value();
+  } else if (value.is_string()) {
+    pred->string = true;
+    pred->str = value.string_value();
+    pred->num = stringToNumber(pred->str);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool FilterProgram::Private::fieldPath(const json11::Json &json,
+                                       std::string *field) {
+  const std::string &type = json["type"].string_value();
+  if (type == "Identifier") {
+    // Only identifiers that compile to OP_LAYER resolve like the index.
+    const std::string &name = json["name"].string_value();
+    if (name == "$" || name == "seq" || name == "ts_sec" ||
+        name == "ts_nsec" || name == "length" || name == "confidence" ||
+        name == "payload" || name == "layers")
+      return false;
+    v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
+    if (global->Has(v8pp::to_v8(isolate, name)))
+      return false;
+    *field = name;
+    return true;
+  }
+
+  if (type != "MemberExpression")
+    return false;
+  const json11::Json &property = json["property"];
+  std::string name;
+  if (property["type"].string_value() == "Identifier" &&
+      !json["computed"].bool_value()) {
+    name = property["name"].string_value();
+  } else if (property["type"].string_value() == "Literal" &&
+             property["value"].is_string()) {
+    name = property["value"].string_value();
+  } else {
+    return false;
+  }
+  if (name.empty() || name.find('.') != std::string::npos ||
+      !fieldPath(json["object"], field))
+    return false;
+  *field += "." + name;
+  return true;
+}
+
+void FilterProgram::Private::fetch(Value *value) {
+  if (value->kind != Value::ITEM)
+    return;
+  const ItemValue &itemValue = value->item->value();
+  switch (itemValue.base()) {
+  case ItemValue::NUL:
+    *value = Value();
+    break;
+  case ItemValue::NUMBER:
+    setNumber(value, itemValue.num());
+    break;
+  case ItemValue::BOOLEAN:
+    setBoolean(value, itemValue.num() != 0);
+    break;
+  case ItemValue::STRING:
+    setString(value, itemValue.str());
+    break;
+  case ItemValue::BUFFER:
+    if (const Buffer *buffer = itemValue.buffer()) {
+      value->kind = Value::BUFFER;
+      value->num = buffer->length();
+    } else {
+      *value = Value();
+    }
+    break;
+  default:
+    fallback = true;
+  }
+}
+
+bool FilterProgram::Private::truthy(Value *value) {
+  fetch(value);
+  switch (value->kind) {
+  case Value::NUL:
+    return false;
+  case Value::NUMBER:
+    return value->num != 0 && !std::isnan(value->num);
+  case Value::BOOLEAN:
+    return value->num != 0;
+  case Value::STRING:
+    return !value->str.empty();
+  default:
+    return true;
+  }
+}
+
+double FilterProgram::Private::number(Value *value) {
+  fetch(value);
+  switch (value->kind) {
+  case Value::NUL:
+    return 0;
+  case Value::NUMBER:
+  case Value::BOOLEAN:
+    return value->num;
+  case Value::STRING:
+    return stringToNumber(value->str);
+  default:
+    fallback = true;
+    return 0;
+  }
+}
+
+bool FilterProgram::Private::equals(Value *lhs, Value *rhs) {
+  fetch(lhs);
+  fetch(rhs);
+  for (const Value *value : {lhs, rhs}) {
+    if (value->kind != Value::NUL && value->kind != Value::NUMBER &&
+        value->kind != Value::BOOLEAN && value->kind != Value::STRING) {
+      fallback = true;
+      return false;
+    }
+  }
+  if (lhs->kind == Value::NUL || rhs->kind == Value::NUL)
+    return lhs->kind == rhs->kind;
+  if (lhs->kind == Value::STRING && rhs->kind == Value::STRING)
+    return lhs->str == rhs->str;
+  return number(lhs) == number(rhs);
+}
+
+void FilterProgram::Private::member(Value *value, uint32_t index) {
+  const std::string &name = names[index];
+  if (name.empty()) {
+    *value = Value();
+    return;
+  }
+
+  switch (value->kind) {
+  case Value::PACKET:
+    packetProperty(value, name);
+    break;
+  case Value::LAYER:
+    if (const std::shared_ptr<Item> &item = value->layer->item(atoms[index])) {
+      value->kind = Value::ITEM;
+      value->item = item.get();
+    } else {
+      layerProperty(value, name);
+    }
+    break;
+  case Value::ITEM:
+    if (const std::shared_ptr<Item> &child = value->item->item(atoms[index])) {
+      value->item = child.get();
+    } else {
+      fetch(value);
+      if (value->kind != Value::ITEM)
+        member(value, index);
+    }
+    break;
+  case Value::STRING:
+    if (name == "length") {
+      setNumber(value, utf16Length(value->str));
+    } else {
+      fallback = true;
+    }
+    break;
+  case Value::BUFFER:
+    if (name == "length") {
+      setNumber(value, value->num);
+    } else {
+      fallback = true;
+    }
+    break;
+  default:
+    *value = Value();
+  }
+}
+
+void FilterProgram::Private::packetProperty(Value *value,
+                                            const std::string &name) {
+  if (name == "seq") {
+    setNumber(value, pkt->seq());
+  } else if (name == "ts_sec") {
+    setNumber(value, pkt->ts_sec());
+  } else if (name == "ts_nsec") {
+    setNumber(value, pkt->ts_nsec());
+  } else if (name == "length") {
+    setNumber(value, pkt->length());
+  } else if (name == "confidence") {
+    setNumber(value, pkt->confidence());
+  } else if (name == "payload" || name == "layers") {
+    fallback = true;
+  } else {
+    *value = Value();
+  }
+}
+
+void FilterProgram::Private::layerProperty(Value *value,
+                                           const std::string &name) {
+  const Layer *layer = value->layer;
+  if (name == "namespace") {
+    setString(value, layer->ns());
+  } else if (name == "name") {
+    setString(value, layer->name());
+  } else if (name == "id") {
+    setString(value, layer->id());
+  } else if (name == "summary") {
+    setString(value, layer->summary());
+  } else if (name == "range") {
+    setString(value, layer->range());
+  } else if (name == "confidence") {
+    setNumber(value, layer->confidence());
+  } else if (name == "payload") {
+    if (const std::unique_ptr<Buffer> &payload = layer->payload()) {
+      value->kind = Value::BUFFER;
+      value->num = payload->length();
+    } else {
+      *value = Value();
+    }
+  } else if (name == "layers" || name == "getValue") {
+    fallback = true;
+  } else {
+    *value = Value();
+  }
+}
+
+void FilterProgram::Private::convert(Value *value,
+                                     v8::Local<v8::Value> result) {
+  *value = Value();
+  if (result.IsEmpty() || result->IsNull() || result->IsUndefined())
+    return;
+  if (result->IsNumber()) {
+    setNumber(value, result->NumberValue());
+  } else if (result->IsBoolean()) {
+    setBoolean(value, result->BooleanValue());
+  } else if (result->IsString()) {
+    setString(value, v8pp::from_v8<std::string>(isolate, result, ""));
+  } else if (Item *item = v8pp::class_<Item>::unwrap_object(isolate, result)) {
+    value->kind = Value::ITEM;
+    value->item = item;
+  } else if (Layer *layer =
+                 v8pp::class_<Layer>::unwrap_object(isolate, result)) {
+    value->kind = Value::LAYER;
+    value->layer = layer;
+  } else if (Buffer *buffer =
+                 v8pp::class_<Buffer>::unwrap_object(isolate, result)) {
+    value->kind = Value::BUFFER;
+    value->num = buffer->length();
+  } else if (v8pp::class_<Packet>::unwrap_object(isolate, result) == pkt) {
+    value->kind = Value::PACKET;
+  } else {
+    fallback = true;
+  }
+}
+
+FilterProgram::FilterProgram(const std::string &jsonstr,
+                             LayerIdTable *layerIds)
+    : d(new Private()) {
+  std::string err;
+  const json11::Json &json = json11::Json::parse(jsonstr, err);
+  d->compile(json);
+  d->collect(json);
+
+  if (layerIds) {
+    for (const std::string &id : d->requiredLayers) {
+      uint64_t bit = layerIds->bit(id);
+      if (bit != LayerIdTable::overflowBit)
+        d->requiredMask |= bit;
+    }
+  }
+}
+
+FilterProgram::~FilterProgram() {}
+
+FilterProgram::Result FilterProgram::evaluate(Packet *pkt) {
+  uint64_t mask = pkt->layerMask();
+  if (mask && (mask & d->requiredMask) != d->requiredMask)
+    return REJECTED;
+
+  std::vector<Value> &stack = d->stack;
+  stack.clear();
+  d->pkt = pkt;
+  d->fallback = false;
+
+  uint32_t pc = 0;
+  while (pc < d->code.size() && !d->fallback) {
+    const Instruction &inst = d->code[pc++];
+
+    if (inst.op >= OP_ADD) {
+      Value rhs = std::move(stack.back());
+      stack.pop_back();
+      Value *lhs = &stack.back();
+      switch (inst.op) {
+      case OP_ADD:
+        setNumber(lhs, d->number(lhs) + d->number(&rhs));
+        break;
+      case OP_SUB:
+        setNumber(lhs, d->number(lhs) - d->number(&rhs));
+        break;
+      case OP_MUL:
+        setNumber(lhs, d->number(lhs) * d->number(&rhs));
+        break;
+      case OP_DIV:
+        setNumber(lhs, d->number(lhs) / d->number(&rhs));
+        break;
+      case OP_MOD: {
+        int32_t a = toInt32(d->number(lhs));
+        int32_t b = toInt32(d->number(&rhs));
+        if (b == 0) {
+          setNumber(lhs, std::numeric_limits<double>::quiet_NaN());
+        } else if (b == -1) {
+          setNumber(lhs, 0);
+        } else {
+          setNumber(lhs, a % b);
+        }
+      } break;
+      case OP_BIT_AND:
+        setNumber(lhs, toInt32(d->number(lhs)) & toInt32(d->number(&rhs)));
+        break;
+      case OP_BIT_OR:
+        setNumber(lhs, toInt32(d->number(lhs)) | toInt32(d->number(&rhs)));
+        break;
+      case OP_BIT_XOR:
+        setNumber(lhs, toInt32(d->number(lhs)) ^ toInt32(d->number(&rhs)));
+        break;
+      case OP_SHR:
+        setNumber(lhs, toInt32(d->number(lhs)) >>
+                           (toInt32(d->number(&rhs)) & 0x1f));
+        break;
+      case OP_SHL:
+        setNumber(lhs, static_cast<int32_t>(
+                           static_cast<uint32_t>(toInt32(d->number(lhs)))
+                           << (toInt32(d->number(&rhs)) & 0x1f)));
+        break;
+      case OP_GT:
+        setBoolean(lhs, d->number(lhs) > d->number(&rhs));
+        break;
+      case OP_LT:
+        setBoolean(lhs, d->number(lhs) < d->number(&rhs));
+        break;
+      case OP_GE:
+        setBoolean(lhs, d->number(lhs) >= d->number(&rhs));
+        break;
+      case OP_LE:
+        setBoolean(lhs, d->number(lhs) <= d->number(&rhs));
+        break;
+      case OP_EQ:
+        setBoolean(lhs, d->equals(lhs, &rhs));
+        break;
+      case OP_NE:
+        setBoolean(lhs, !d->equals(lhs, &rhs));
+        break;
+      default:;
+      }
+      continue;
+    }
+
+    switch (inst.op) {
+    case OP_CONST:
+      stack.push_back(d->constants[inst.arg]);
+      break;
+    case OP_PACKET:
+      stack.emplace_back();
+      stack.back().kind = Value::PACKET;
+      break;
+    case OP_LAYER:
+    case OP_GLOBAL:
+      stack.emplace_back();
+      if (const Layer *layer = findLayer(d->atoms[inst.arg], pkt->layers())) {
+        stack.back().kind = Value::LAYER;
+        stack.back().layer = layer;
+      } else if (inst.op == OP_GLOBAL) {
+        d->fallback = true;
+      }
+      break;
+    case OP_MEMBER:
+      d->member(&stack.back(), inst.arg);
+      break;
+    case OP_V8: {
+      v8::HandleScope scope(d->isolate);
+      stack.emplace_back();
+      d->convert(&stack.back(), d->subtrees[inst.arg](pkt).value);
+    } break;
+    case OP_POP:
+      stack.pop_back();
+      break;
+    case OP_JUMP:
+      pc = inst.arg;
+      break;
+    case OP_JUMP_IF_FALSE:
+      if (!d->truthy(&stack.back()))
+        pc = inst.arg;
+      stack.pop_back();
+      break;
+    case OP_JUMP_IF_TRUE_KEEP:
+    case OP_JUMP_IF_FALSE_KEEP: {
+      // The operand stays on the stack unfetched, so test a copy.
+      Value test = stack.back();
+      if (d->truthy(&test) == (inst.op == OP_JUMP_IF_TRUE_KEEP))
+        pc = inst.arg;
+    } break;
+    case OP_POS:
+      setNumber(&stack.back(), d->number(&stack.back()));
+      break;
+    case OP_NEG:
+      setNumber(&stack.back(), -d->number(&stack.back()));
+      break;
+    case OP_NOT:
+      setBoolean(&stack.back(), !d->truthy(&stack.back()));
+      break;
+    case OP_BIT_NOT:
+      setNumber(&stack.back(), ~toInt32(d->number(&stack.back())));
+      break;
+    default:;
+    }
+  }
+
+  bool matched = !stack.empty() && d->truthy(&stack.back());
+  if (d->fallback)
+    return FALLBACK;
+  return matched ? MATCHED : REJECTED;
+}
+
+bool FilterProgram::lookup(const FieldIndex &index, RoaringBitmap *matched,
+                           RoaringBitmap *resolved) const {
+  // A packet is rejected as soon as one comparison is known to be false,
+  // but only matches if every term of the conjunction is indexed.
+  bool complete = d->conjunctive;
+  bool found = false;
+  RoaringBitmap accepted;
+  RoaringBitmap rejected;
+  for (const FieldIndex::Predicate &pred : d->predicates) {
+    RoaringBitmap termMatched;
+    RoaringBitmap termResolved;
+    if (!index.query(pred, &termMatched, &termResolved)) {
+      complete = false;
+      continue;
+    }
+    rejected = rejected | termResolved.andNot(termMatched);
+    accepted = found ? (accepted & termMatched) : termMatched;
+    found = true;
+  }
+  if (!found)
+    return false;
+
+  *matched = complete ? accepted : RoaringBitmap();
+  *resolved = *matched | rejected;
+  return true;
+}
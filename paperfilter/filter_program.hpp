@@ -0,0 +1,42 @@
+#ifndef FILTER_PROGRAM_HPP
+#define FILTER_PROGRAM_HPP
+
+#include <memory>
+#include <string>
+
+class FieldIndex;
+class LayerIdTable;
+class Packet;
+class RoaringBitmap;
+
+// FilterProgram compiles a filter AST into bytecode that evaluates
+// directly over the native packet representation. Only call expressions,
+// regex literals and a few object-valued properties go through V8.
+class FilterProgram {
+public:
+  enum Result { REJECTED, MATCHED, FALLBACK };
+
+public:
+  explicit FilterProgram(const std::string &jsonstr,
+                         LayerIdTable *layerIds = nullptr);
+  ~FilterProgram();
+  FilterProgram(const FilterProgram &) = delete;
+  FilterProgram &operator=(const FilterProgram &) = delete;
+
+  // Returns FALLBACK when the packet holds a value that has no native
+  // semantics (e.g. a JSON item). The caller must then evaluate the
+  // packet with the V8 filter from makeFilter().
+  Result evaluate(Packet *pkt);
+
+  // Answers the field comparisons of a top-level conjunction from |index|.
+  // |resolved| receives the seqs whose result is known and |matched| those
+  // among them that match. Returns false if no comparison is indexed.
+  bool lookup(const FieldIndex &index, RoaringBitmap *matched,
+              RoaringBitmap *resolved) const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -2,63 +2,105 @@
 #include "log_message.hpp"
 #include "packet.hpp"
 #include "packet_store.hpp"
+#include "isolate_pool.hpp"
 #include "paper_context.hpp"
 #include "console.hpp"
 #include "filter.hpp"
+#include "field_index.hpp"
+#include "filter_program.hpp"
+#include <algorithm>
 #include <cstdlib>
 #include <nan.h>
+#include <iterator>
 #include <thread>
+#include <unordered_map>
 #include <v8pp/class.hpp>
 #include <v8pp/object.hpp>
 #include <v8pp/context.hpp>
 
 namespace {
-class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
-public:
-  ArrayBufferAllocator() {}
-  ~ArrayBufferAllocator() {}
+const uint64_t indexRefresh = 65536;
+
+struct CompiledFilter {
+  std::shared_ptr<FilterTask> task;
+  FilterFunc func;
+  std::unique_ptr<FilterProgram> program;
+
+  // Results answered from the field index, refreshed every indexRefresh
+  // newly indexed packets.
+  bool indexed = false;
+  uint64_t indexSize = 0;
+  RoaringBitmap indexMatched;
+  RoaringBitmap indexResolved;
+};
+
+typedef std::pair<uint32_t, uint32_t> Span;
 
-  virtual void *Allocate(size_t size) { return calloc(1, size); }
-  virtual void *AllocateUninitialized(size_t size) { return malloc(size); }
-  virtual void Free(void *data, size_t) { free(data); }
+struct TaskRange {
+  std::string name;
+  std::shared_ptr<FilterTask> task;
+  std::vector<Span> spans;
+  std::vector<uint32_t> seqs;
+  std::vector<uint32_t> matches;
 };
+
+uint32_t firstUnclaimed(const FilterTask &task, uint32_t seq) {
+  seq = std::max(seq, task.maxSeq + 1);
+  auto it = task.claimed.upper_bound(seq);
+  if (it != task.claimed.begin() && std::prev(it)->second >= seq)
+    seq = std::prev(it)->second + 1;
+  for (; it != task.claimed.end() && it->first <= seq; ++it) {
+    seq = std::max(seq, it->second + 1);
+  }
+  return seq;
+}
+
+std::vector<Span> claim(FilterTask *task, uint32_t start, uint32_t end) {
+  std::vector<Span> spans;
+  for (uint32_t seq = firstUnclaimed(*task, start); seq <= end;) {
+    auto next = task->claimed.upper_bound(seq);
+    uint32_t last = end;
+    if (next != task->claimed.end())
+      last = std::min(end, next->first - 1);
+    spans.emplace_back(seq, last);
+    task->claimed[seq] = last;
+    if (last == end)
+      break;
+    seq = firstUnclaimed(*task, last + 1);
+  }
+
+  for (auto it = task->claimed.begin();
+       it != task->claimed.end() && it->first <= task->maxSeq + 1;
+       it = task->claimed.erase(it)) {
+    task->maxSeq = std::max(task->maxSeq, it->second);
+  }
+  return spans;
+}
 }
 
 class FilterThread::Private {
 public:
-  Private(const std::shared_ptr<Context> &ctx);
+  Private(const std::shared_ptr<FilterSharedContext> &ctx);
   ~Private();
 
 public:
   std::thread thread;
-  std::shared_ptr<Context> ctx;
-  int storeHandlerId;
+  std::shared_ptr<FilterSharedContext> ctx;
   bool closed = false;
 };
 
-FilterThread::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {
-  storeHandlerId = ctx->store->addHandler(
-      [this](uint32_t maxSeq) { this->ctx->cond.notify_all(); });
-
+FilterThread::Private::Private(const std::shared_ptr<FilterSharedContext> &ctx)
+    : ctx(ctx) {
   thread = std::thread([this]() {
-    Context &ctx = *this->ctx;
+    FilterSharedContext &ctx = *this->ctx;
 
-    v8::Isolate::CreateParams create_params;
-    create_params.array_buffer_allocator = new ArrayBufferAllocator();
-    v8::Isolate *isolate = v8::Isolate::New(create_params);
-
-    // workaround for chromium task runner
-    char dummyData[128] = {0};
-    isolate->SetData(0, dummyData);
+    v8::Isolate *isolate = IsolatePool::acquire();
 
     static const int filterQuota = 1024;
 
     {
-      std::unique_ptr<v8::Locker> locker;
+      v8::Locker locker(isolate);
       v8::Isolate::Scope isolate_scope(isolate);
-      if (v8::Locker::IsActive()) {
-        locker.reset(new v8::Locker(isolate));
-      }
       v8::HandleScope handle_scope(isolate);
       v8pp::context ppctx(isolate);
       v8::TryCatch try_catch;
@@ -68,42 +110,185 @@ FilterThread::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {
           v8pp::class_<Console>::create_object(isolate, ctx.logCb, "filter");
       ppctx.set("console", console);
 
-      const FilterFunc &func = makeFilter(ctx.filter);
+      // Programs are compiled lazily per task and kept while the task is
+      // active, so the isolate outlives any single filter.
+      std::unordered_map<std::string, CompiledFilter> compiled;
+
+      auto pending = [&ctx](uint32_t maxSeq) {
+        for (const auto &pair : ctx.tasks) {
+          if (pair.second->maxSeq < maxSeq)
+            return true;
+        }
+        return false;
+      };
 
       while (true) {
         std::unique_lock<std::mutex> lock(ctx.mutex);
-        ctx.cond.wait(lock, [this, &ctx] {
-          return ctx.maxSeq < ctx.store->maxSeq() || closed;
+        ctx.cond.wait(lock, [this, &ctx, &pending] {
+          return pending(ctx.store->maxSeq()) || closed;
         });
         if (closed)
           break;
+
+        // Claim one packet range for every task that has not reached it
+        // yet, so the packets are fetched once for all active filters.
+        // Ranges inside the viewport go first and the rest is backfilled
+        // in ascending order.
         uint32_t maxSeq = ctx.store->maxSeq();
-        if (ctx.maxSeq < maxSeq) {
-          uint32_t start = ctx.maxSeq + 1;
-          uint32_t end = std::min(start + filterQuota, maxSeq);
-          ctx.maxSeq = end;
-          lock.unlock();
-          const std::vector<std::shared_ptr<Packet>> &packets =
-              ctx.store->get(start, end);
-          std::vector<std::pair<uint32_t, bool>> results;
+        uint32_t start = 0;
+        uint32_t end = 0;
+        if (ctx.viewStart > 0) {
+          uint32_t viewEnd = std::min(ctx.viewEnd, maxSeq);
+          for (const auto &pair : ctx.tasks) {
+            uint32_t seq = firstUnclaimed(*pair.second, ctx.viewStart);
+            if (seq <= viewEnd && (start == 0 || seq < start))
+              start = seq;
+          }
+          end = std::min(start + filterQuota, viewEnd);
+        }
+        if (start == 0) {
+          start = maxSeq;
+          for (const auto &pair : ctx.tasks) {
+            start = std::min(start, pair.second->maxSeq + 1);
+          }
+          end = std::min(start + filterQuota, maxSeq);
+        }
+
+        std::vector<TaskRange> batch;
+        for (const auto &pair : ctx.tasks) {
+          const std::vector<Span> &spans = claim(pair.second.get(), start, end);
+          if (!spans.empty())
+            batch.push_back(TaskRange{pair.first, pair.second, spans, {}});
+        }
+
+        for (auto it = compiled.begin(); it != compiled.end();) {
+          if (ctx.tasks.count(it->first)) {
+            ++it;
+          } else {
+            it = compiled.erase(it);
+          }
+        }
+        lock.unlock();
+
+        uint64_t indexSize = ctx.index ? ctx.index->size() : 0;
+        for (const TaskRange &range : batch) {
+          const FilterTask &task = *range.task;
+          CompiledFilter &filter = compiled[range.name];
+          if (filter.task != range.task) {
+            v8::HandleScope scope(isolate);
+            filter.task = range.task;
+            filter.func = makeFilter(task.filter);
+            if (ctx.native)
+              filter.program.reset(
+                  new FilterProgram(task.filter, ctx.layerIds.get()));
+            filter.indexed = false;
+            filter.indexSize = 0;
+          }
+          if (filter.program && indexSize > 0 &&
+              (filter.indexSize == 0 ||
+               indexSize >= filter.indexSize + indexRefresh)) {
+            filter.indexed = filter.program->lookup(
+                *ctx.index, &filter.indexMatched, &filter.indexResolved);
+            filter.indexSize = indexSize;
+          }
+        }
+
+        // Refined tasks only evaluate the seqs their base filter matched,
+        // and seqs decided by the field index are not evaluated at all.
+        std::vector<bool> needed(end - start + 1, false);
+        for (TaskRange &range : batch) {
+          const FilterTask &task = *range.task;
+          const CompiledFilter &filter = compiled[range.name];
+          for (const Span &span : range.spans) {
+            uint32_t seq = span.first;
+            uint32_t limit = std::min(span.second, task.candidateMaxSeq);
+            if (seq <= limit) {
+              uint64_t first = task.candidates.rank(seq - 1);
+              uint64_t last = task.candidates.rank(limit);
+              if (first < last) {
+                const std::vector<uint32_t> &candidates =
+                    task.candidates.slice(first, last - 1);
+                range.seqs.insert(range.seqs.end(), candidates.begin(),
+                                  candidates.end());
+              }
+              seq = limit + 1;
+            }
+            for (; seq <= span.second; ++seq) {
+              range.seqs.push_back(seq);
+            }
+          }
+          if (filter.indexed) {
+            std::vector<uint32_t> seqs;
+            for (uint32_t seq : range.seqs) {
+              if (!filter.indexResolved.contains(seq)) {
+                seqs.push_back(seq);
+              } else if (filter.indexMatched.contains(seq)) {
+                range.matches.push_back(seq);
+              }
+            }
+            range.seqs.swap(seqs);
+          }
+          for (uint32_t seq : range.seqs) {
+            needed[seq - start] = true;
+          }
+        }
+
+        std::vector<std::shared_ptr<Packet>> packets;
+        if (std::find(needed.begin(), needed.end(), false) == needed.end()) {
+          packets = ctx.store->get(start, end);
+        } else {
+          packets.resize(needed.size());
+          for (size_t i = 0; i < needed.size(); ++i) {
+            if (needed[i])
+              packets[i] = ctx.store->get(start + i);
+          }
+        }
+        if (ctx.dissectCb) {
+          std::vector<std::shared_ptr<Packet>> dissect;
           for (const auto &pkt : packets) {
-            v8::Local<v8::Value> result = func(pkt.get()).value;
-            ctx.packets.insert(pkt->seq(), result->BooleanValue());
+            if (pkt)
+              dissect.push_back(pkt);
+          }
+          ctx.dissectCb(dissect);
+        }
+
+        for (const TaskRange &range : batch) {
+          FilterTask &task = *range.task;
+          CompiledFilter &filter = compiled[range.name];
+
+          std::vector<uint32_t> matches = range.matches;
+          for (uint32_t seq : range.seqs) {
+            Packet *pkt = packets[seq - start].get();
+            if (!pkt)
+              continue;
+            FilterProgram::Result result =
+                filter.program ? filter.program->evaluate(pkt)
+                               : FilterProgram::FALLBACK;
+            bool matched = result == FilterProgram::MATCHED;
+            if (result == FilterProgram::FALLBACK) {
+              v8::HandleScope scope(isolate);
+              matched = filter.func(pkt).value->BooleanValue();
+            }
+            if (matched)
+              matches.push_back(seq);
           }
-          lock.lock();
-          for (const auto &pair : results) {
-            ctx.packets.insert(pair.first, pair.second);
+          std::sort(matches.begin(), matches.end());
+          auto match = matches.begin();
+          for (const Span &span : range.spans) {
+            auto last = std::upper_bound(match, matches.end(), span.second);
+            task.packets.insert(span.first, span.second,
+                                std::vector<uint32_t>(match, last));
+            match = last;
           }
         }
       }
     }
 
-    isolate->Dispose();
+    IsolatePool::release(isolate);
   });
 }
 
 FilterThread::Private::~Private() {
-  this->ctx->store->removeHandler(storeHandlerId);
   {
     std::unique_lock<std::mutex> lock(this->ctx->mutex);
     closed = true;
@@ -113,7 +298,7 @@ FilterThread::Private::~Private() {
     thread.join();
 }
 
-FilterThread::FilterThread(const std::shared_ptr<Context> &ctx)
+FilterThread::FilterThread(const std::shared_ptr<FilterSharedContext> &ctx)
     : d(new Private(ctx)) {}
 
 FilterThread::~FilterThread() {}
@@ -2,32 +2,56 @@
 #define FILTER_THREAD_HPP
 
 #include "filtered_packet_store.hpp"
+#include "roaring_bitmap.hpp"
 #include <condition_variable>
 #include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+class FieldIndex;
+class LayerIdTable;
 class Packet;
 class PacketStore;
 struct LogMessage;
 
-class FilterThread {
-public:
-  struct Context {
-    std::mutex mutex;
-    std::condition_variable cond;
-    uint32_t maxSeq = 0;
-    PacketStore *store = nullptr;
-    FilteredPacketStore packets;
-    std::string filter;
-    std::string script;
-    std::function<void(const LogMessage &)> logCb;
-  };
+struct FilterTask {
+  std::string filter;
+  FilteredPacketStore packets;
+
+  // Every seq up to maxSeq has been claimed by a worker. Ranges claimed
+  // ahead of it for the viewport are kept in |claimed| (start -> end).
+  uint32_t maxSeq = 0;
+  std::map<uint32_t, uint32_t> claimed;
+
+  // When the filter refines an earlier one, only the seqs that filter
+  // matched need to be evaluated up to candidateMaxSeq.
+  RoaringBitmap candidates;
+  uint32_t candidateMaxSeq = 0;
+};
+
+struct FilterSharedContext {
+  std::mutex mutex;
+  std::condition_variable cond;
+  PacketStore *store = nullptr;
+  std::shared_ptr<FieldIndex> index;
+  std::shared_ptr<LayerIdTable> layerIds;
+  // When false, every packet is evaluated by the V8 filter from
+  // makeFilter() and FilterProgram is not used.
+  bool native = true;
+  std::unordered_map<std::string, std::shared_ptr<FilterTask>> tasks;
+  uint32_t viewStart = 0;
+  uint32_t viewEnd = 0;
+  std::function<void(const LogMessage &)> logCb;
+  std::function<void(const std::vector<std::shared_ptr<Packet>> &)> dissectCb;
+};
 
+class FilterThread {
 public:
-  FilterThread(const std::shared_ptr<Context> &ctx);
+  FilterThread(const std::shared_ptr<FilterSharedContext> &ctx);
   ~FilterThread();
   FilterThread(const FilterThread &) = delete;
   FilterThread &operator=(const FilterThread &) = delete;
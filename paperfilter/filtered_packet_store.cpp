@@ -1,4 +1,6 @@
 #include "filtered_packet_store.hpp"
+#include "roaring_bitmap.hpp"
+#include <algorithm>
 #include <map>
 #include <unordered_map>
 #include <uv.h>
@@ -7,19 +9,42 @@ class FilteredPacketStore::Private {
 public:
   Private();
   ~Private();
+  void flush();
+  void notify();
 
 public:
   uv_rwlock_t rwlock;
   std::unordered_map<int, std::function<void(uint32_t)>> handlers;
   uint32_t maxSeq = 0;
-  std::map<uint32_t, bool> queue;
-  std::vector<uint32_t> packets;
+  uint32_t size = 0;
+
+  // Matches are added to the bitmap as soon as they are known, but only
+  // those up to maxSeq are visible. Ranges finished out of order wait in
+  // |pending| (start -> end) until the gap before them is filled.
+  RoaringBitmap packets;
+  std::map<uint32_t, uint32_t> pending;
 };
 
 FilteredPacketStore::Private::Private() { uv_rwlock_init(&rwlock); }
 
 FilteredPacketStore::Private::~Private() { uv_rwlock_destroy(&rwlock); }
 
+void FilteredPacketStore::Private::flush() {
+  for (auto it = pending.begin();
+       it != pending.end() && it->first <= maxSeq + 1;
+       it = pending.erase(it)) {
+    maxSeq = std::max(maxSeq, it->second);
+  }
+}
+
+void FilteredPacketStore::Private::notify() {
+  size = packets.rank(maxSeq);
+  for (const auto &pair : handlers) {
+    if (pair.second)
+      pair.second(size);
+  }
+}
+
 FilteredPacketStore::FilteredPacketStore() : d(new Private()) {}
 
 FilteredPacketStore::~FilteredPacketStore() {}
@@ -30,8 +55,8 @@ std::vector<uint32_t> FilteredPacketStore::get(uint32_t start,
   if (start > end)
     return seq;
   uv_rwlock_rdlock(&d->rwlock);
-  for (uint32_t i = start; i <= end && i < d->packets.size(); ++i)
-    seq.push_back(d->packets[i]);
+  if (start < d->size)
+    seq = d->packets.slice(start, std::min(end, d->size - 1));
   uv_rwlock_rdunlock(&d->rwlock);
   return seq;
 }
@@ -39,37 +64,106 @@ std::vector<uint32_t> FilteredPacketStore::get(uint32_t start,
 uint32_t FilteredPacketStore::get(uint32_t index) const {
   uint32_t seq = 0;
   uv_rwlock_rdlock(&d->rwlock);
-  if (index < d->packets.size())
-    seq = d->packets[index];
+  if (index < d->size)
+    seq = d->packets.select(index);
+  uv_rwlock_rdunlock(&d->rwlock);
+  return seq;
+}
+
+std::vector<uint32_t> FilteredPacketStore::getRange(uint32_t startSeq,
+                                                    uint32_t endSeq) const {
+  std::vector<uint32_t> seq;
+  uv_rwlock_rdlock(&d->rwlock);
+  // Unlike get(), this also returns matches from ranges that finished
+  // ahead of maxSeq, e.g. ones prioritized for the viewport.
+  std::vector<std::pair<uint32_t, uint32_t>> ranges;
+  if (d->maxSeq > 0)
+    ranges.emplace_back(1, d->maxSeq);
+  ranges.insert(ranges.end(), d->pending.begin(), d->pending.end());
+  for (const auto &range : ranges) {
+    uint32_t first = std::max(range.first, startSeq);
+    uint32_t last = std::min(range.second, endSeq);
+    if (first > last)
+      continue;
+    uint64_t begin = d->packets.rank(first - 1);
+    uint64_t end = d->packets.rank(last);
+    if (begin < end) {
+      const std::vector<uint32_t> &matches = d->packets.slice(begin, end - 1);
+      seq.insert(seq.end(), matches.begin(), matches.end());
+    }
+  }
   uv_rwlock_rdunlock(&d->rwlock);
   return seq;
 }
 
 void FilteredPacketStore::insert(uint32_t seq, bool match) {
   uv_rwlock_wrlock(&d->rwlock);
-  d->queue[seq] = match;
   uint32_t maxSeq = d->maxSeq;
-  auto end = d->queue.begin();
-  for (auto it = d->queue.find(maxSeq + 1); it != d->queue.end();
-       end = it, it = d->queue.find(++maxSeq + 1)) {
-    if (it->second) {
-      d->packets.push_back(it->first);
-    }
-  }
-  if (d->maxSeq < maxSeq) {
-    d->maxSeq = maxSeq;
-    d->queue.erase(d->queue.begin(), end);
-    for (const auto &pair : d->handlers) {
-      if (pair.second)
-        pair.second(d->packets.size());
-    }
+  if (match)
+    d->packets.add(seq);
+  d->pending[seq] = seq;
+  d->flush();
+  if (maxSeq < d->maxSeq)
+    d->notify();
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+void FilteredPacketStore::insert(uint32_t start, uint32_t end,
+                                 const std::vector<uint32_t> &matches) {
+  if (start > end)
+    return;
+  uv_rwlock_wrlock(&d->rwlock);
+  uint32_t maxSeq = d->maxSeq;
+  for (uint32_t seq : matches) {
+    d->packets.add(seq);
   }
+  d->pending[start] = end;
+  d->flush();
+  if (maxSeq < d->maxSeq)
+    d->notify();
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+void FilteredPacketStore::assign(const RoaringBitmap &matches,
+                                 uint32_t maxSeq) {
+  uv_rwlock_wrlock(&d->rwlock);
+  d->packets = matches;
+  d->pending.clear();
+  d->maxSeq = maxSeq;
+  d->notify();
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+void FilteredPacketStore::assign(uint32_t fromSeq, const RoaringBitmap &matches,
+                                 uint32_t maxSeq) {
+  uv_rwlock_wrlock(&d->rwlock);
+  d->packets.replaceTail(fromSeq, matches);
+  d->pending.clear();
+  d->maxSeq = maxSeq;
+  d->notify();
   uv_rwlock_wrunlock(&d->rwlock);
 }
 
+RoaringBitmap FilteredPacketStore::matches(uint32_t fromSeq,
+                                           uint32_t *maxSeq) const {
+  uv_rwlock_rdlock(&d->rwlock);
+  RoaringBitmap packets = d->packets.tail(fromSeq);
+  *maxSeq = d->maxSeq;
+  uv_rwlock_rdunlock(&d->rwlock);
+  return packets;
+}
+
+RoaringBitmap FilteredPacketStore::matches(uint32_t *maxSeq) const {
+  uv_rwlock_rdlock(&d->rwlock);
+  RoaringBitmap packets = d->packets;
+  *maxSeq = d->maxSeq;
+  uv_rwlock_rdunlock(&d->rwlock);
+  return packets;
+}
+
 uint32_t FilteredPacketStore::size() const {
   uv_rwlock_rdlock(&d->rwlock);
-  uint32_t size = d->packets.size();
+  uint32_t size = d->size;
   uv_rwlock_rdunlock(&d->rwlock);
   return size;
 }
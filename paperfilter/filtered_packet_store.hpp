@@ -5,6 +5,8 @@
 #include <memory>
 #include <functional>
 
+class RoaringBitmap;
+
 class FilteredPacketStore {
 public:
   FilteredPacketStore();
@@ -12,8 +14,18 @@ public:
   FilteredPacketStore(const FilteredPacketStore &) = delete;
   FilteredPacketStore &operator=(const FilteredPacketStore &) = delete;
   void insert(uint32_t seq, bool match);
+  void insert(uint32_t start, uint32_t end,
+              const std::vector<uint32_t> &matches);
+  void assign(const RoaringBitmap &matches, uint32_t maxSeq);
+  // Replaces the matches from the partition holding |fromSeq| on, keeping
+  // earlier ones.
+  void assign(uint32_t fromSeq, const RoaringBitmap &matches, uint32_t maxSeq);
+  RoaringBitmap matches(uint32_t *maxSeq) const;
+  // Only the matches from the partition holding |fromSeq| on.
+  RoaringBitmap matches(uint32_t fromSeq, uint32_t *maxSeq) const;
   std::vector<uint32_t> get(uint32_t start, uint32_t end) const;
   uint32_t get(uint32_t index) const;
+  std::vector<uint32_t> getRange(uint32_t startSeq, uint32_t endSeq) const;
   uint32_t size() const;
   uint32_t maxSeq() const;
   int addHandler(const std::function<void(uint32_t)> &cb);
@@ -67,12 +67,26 @@ class Session extends EventEmitter {
       namespace: option.namespace,
       dissectors: [],
       stream_dissectors: [],
-      config: option.config
+      config: option.config,
+      memory_budget: option.memory_budget,
+      threads: option.threads,
+      queue_limit: option.queue_limit,
+      queue_policy: option.queue_policy,
+      lazy: option.lazy,
+      native_filter: option.native_filter,
+      field_index: option.field_index
     };
     let errors = [];
     let tasks = [];
     if (Array.isArray(option.dissectors)) {
       for (let diss of option.dissectors) {
+        if (diss.native != null) {
+          sessOption.dissectors.push({
+            native: diss.native,
+            resourceName: `native:${diss.native}`
+          });
+          continue;
+        }
         tasks.push(roll(diss.script).then((code) => {
           sessOption.dissectors.push({
             script: code,
@@ -122,6 +136,10 @@ class Session extends EventEmitter {
     return this._sess.filter(name, body);
   }
 
+  combine(name, op, sources) {
+    return this._sess.combine(name, op, sources);
+  }
+
   get(seq) {
     return this._sess.get(seq);
   }
@@ -130,6 +148,14 @@ class Session extends EventEmitter {
     return this._sess.getFiltered(name, start, end);
   }
 
+  getFilteredRange(name, startSeq, endSeq) {
+    return this._sess.getFilteredRange(name, startSeq, endSeq);
+  }
+
+  setViewport(start, end, name = '') {
+    return this._sess.setViewport(start, end, name);
+  }
+
   get namespace() {
     return this._sess.namespace;
   }
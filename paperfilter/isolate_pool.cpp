@@ -0,0 +1,89 @@
+#include "isolate_pool.hpp"
+#include "paper_context.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
+public:
+  ArrayBufferAllocator() {}
+  ~ArrayBufferAllocator() {}
+
+  virtual void *Allocate(size_t size) { return calloc(1, size); }
+  virtual void *AllocateUninitialized(size_t size) { return malloc(size); }
+  virtual void Free(void *data, size_t) { free(data); }
+};
+
+struct PooledIsolate {
+  std::unique_ptr<ArrayBufferAllocator> allocator;
+  std::unique_ptr<char[]> dummyData;
+};
+
+std::mutex poolMutex;
+std::unordered_map<v8::Isolate *, PooledIsolate> isolates;
+std::vector<v8::Isolate *> idleIsolates;
+
+size_t poolLimit() {
+  return std::max(2u, std::thread::hardware_concurrency() * 2);
+}
+}
+
+v8::Isolate *IsolatePool::acquire() {
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!idleIsolates.empty()) {
+      v8::Isolate *isolate = idleIsolates.back();
+      idleIsolates.pop_back();
+      return isolate;
+    }
+  }
+
+  PooledIsolate pooled;
+  pooled.allocator.reset(new ArrayBufferAllocator());
+  pooled.dummyData.reset(new char[128]());
+
+  v8::Isolate::CreateParams create_params;
+  create_params.array_buffer_allocator = pooled.allocator.get();
+  v8::Isolate *isolate = v8::Isolate::New(create_params);
+
+  // workaround for chromium task runner
+  isolate->SetData(0, pooled.dummyData.get());
+
+  std::lock_guard<std::mutex> lock(poolMutex);
+  isolates.emplace(isolate, std::move(pooled));
+  return isolate;
+}
+
+void IsolatePool::release(v8::Isolate *isolate) {
+  bool keep = false;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    keep = idleIsolates.size() < poolLimit();
+  }
+
+  if (keep) {
+    // Collect the contexts of the finished thread before parking.
+    {
+      v8::Locker locker(isolate);
+      v8::Isolate::Scope isolate_scope(isolate);
+      isolate->LowMemoryNotification();
+    }
+    std::lock_guard<std::mutex> lock(poolMutex);
+    idleIsolates.push_back(isolate);
+    return;
+  }
+
+  {
+    v8::Locker locker(isolate);
+    v8::Isolate::Scope isolate_scope(isolate);
+    PaperContext::dispose(isolate);
+  }
+  isolate->Dispose();
+  std::lock_guard<std::mutex> lock(poolMutex);
+  isolates.erase(isolate);
+}
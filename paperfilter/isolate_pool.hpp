@@ -0,0 +1,17 @@
+#ifndef ISOLATE_POOL_HPP
+#define ISOLATE_POOL_HPP
+
+#include <v8.h>
+
+// IsolatePool keeps the isolates of finished worker threads, so that the
+// workers started by the next Session::reset() skip isolate creation and
+// reuse the dripcap module templates built by PaperContext::init().
+// A pooled isolate moves between threads, so every user must hold a
+// v8::Locker on it for as long as it is entered.
+class IsolatePool {
+public:
+  static v8::Isolate *acquire();
+  static void release(v8::Isolate *isolate);
+};
+
+#endif
@@ -1,34 +1,83 @@
 #include "item.hpp"
 #include "item_value.hpp"
+#include "layer_arena.hpp"
+#include "serialization.hpp"
 #include <v8pp/class.hpp>
 #include <v8pp/object.hpp>
+#include <unordered_map>
 #include <vector>
 
 using namespace v8;
 
 class Item::Private {
 public:
+  // Names are only displayed and are often taken from packet data, so they
+  // are not interned.
   std::string name;
-  std::string id;
+  Atom id;
+  // Holds the id when it could not be interned; see Atom::bounded().
+  std::string overflowId;
   std::string range;
   std::string summary;
   ItemValue value;
-  std::vector<std::shared_ptr<Item>> items;
-  std::map<std::string, size_t> keys;
+  ArenaVector<std::shared_ptr<Item>> items;
+  ArenaMap<Atom, size_t> keys;
+  bool unkeyed = false;
+
+public:
+  void setId(const std::string &str);
+  void addKey();
+  std::shared_ptr<Item> find(Atom atom, const std::string &str) const;
 };
 
-Item::Item() : d(new Private()) {}
+void Item::Private::setId(const std::string &str) {
+  if (Atom::bounded(str, &id)) {
+    overflowId.clear();
+  } else {
+    overflowId = str;
+  }
+}
+
+// Children with overflow ids are not keyed and are found by a scan.
+void Item::Private::addKey() {
+  Atom atom = items.back()->idAtom();
+  if (atom.valid()) {
+    keys[atom] = items.size() - 1;
+  } else {
+    unkeyed = true;
+  }
+}
+
+std::shared_ptr<Item> Item::Private::find(Atom atom,
+                                          const std::string &str) const {
+  if (atom.valid()) {
+    auto it = keys.find(atom);
+    if (it != keys.end())
+      return items[it->second];
+  }
+  if (unkeyed) {
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+      if (!(*it)->idAtom().valid() && (*it)->id() == str)
+        return *it;
+    }
+  }
+  return std::shared_ptr<Item>();
+}
+
+Item::Item() : d(LayerArena::make<Private>()) {}
 
 Item::Item(const v8::FunctionCallbackInfo<v8::Value> &args) : Item(args[0]) {}
 
-Item::Item(const Item &item) : d(new Private(*item.d)) {}
+Item::Item(const Item &item) : d(LayerArena::make<Private>(*item.d)) {}
 
-Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
+Item::Item(v8::Local<v8::Value> value) : d(LayerArena::make<Private>()) {
   Isolate *isolate = Isolate::GetCurrent();
   if (!value.IsEmpty() && value->IsObject()) {
     v8::Local<v8::Object> obj = value.As<v8::Object>();
+    std::string id;
     v8pp::get_option(isolate, obj, "name", d->name);
-    v8pp::get_option(isolate, obj, "id", d->id);
+    v8pp::get_option(isolate, obj, "id", id);
+    d->setId(id);
     v8pp::get_option(isolate, obj, "range", d->range);
     v8pp::get_option(isolate, obj, "summary", d->summary);
 
@@ -53,15 +102,32 @@ Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
   }
 }
 
+Item::Item(std::istream &is) : d(LayerArena::make<Private>()) {
+  d->name = readString(is);
+  d->setId(readString(is));
+  d->range = readString(is);
+  d->summary = readString(is);
+  d->value = ItemValue(is);
+  uint32_t size = readValue<uint32_t>(is);
+  for (uint32_t i = 0; i < size && is; ++i) {
+    d->items.emplace_back(LayerArena::make<Item>(is));
+    d->addKey();
+  }
+}
+
 Item::~Item() {}
 
-std::string Item::name() const { return d->name; }
+const std::string &Item::name() const { return d->name; }
 
 void Item::setName(const std::string &name) { d->name = name; }
 
-std::string Item::id() const { return d->id; }
+const std::string &Item::id() const {
+  return d->id.valid() ? d->id.str() : d->overflowId;
+}
+
+Atom Item::idAtom() const { return d->id; }
 
-void Item::setId(const std::string &id) { d->id = id; }
+void Item::setId(const std::string &id) { d->setId(id); }
 
 std::string Item::range() const { return d->range; }
 
@@ -77,7 +143,7 @@ std::string Item::summary() const { return d->summary; }
 
 void Item::setSummary(const std::string &summary) { d->summary = summary; }
 
-ItemValue Item::value() const { return d->value; }
+const ItemValue &Item::value() const { return d->value; }
 
 void Item::setValue(v8::Local<v8::Object> value) {
   Isolate *isolate = Isolate::GetCurrent();
@@ -86,26 +152,35 @@ void Item::setValue(v8::Local<v8::Object> value) {
   }
 }
 
-std::vector<std::shared_ptr<Item>> Item::items() const { return d->items; }
+void Item::setValue(const ItemValue &value) { d->value = value; }
+
+std::vector<std::shared_ptr<Item>> Item::items() const {
+  return std::vector<std::shared_ptr<Item>>(d->items.begin(), d->items.end());
+}
 
 void Item::addItem(v8::Local<v8::Object> obj) {
   Isolate *isolate = Isolate::GetCurrent();
   if (Item *item = v8pp::class_<Item>::unwrap_object(isolate, obj)) {
-    d->items.emplace_back(std::make_shared<Item>(*item));
+    d->items.emplace_back(LayerArena::make<Item>(*item));
   } else if (obj->IsObject()) {
-    d->items.emplace_back(std::make_shared<Item>(obj));
+    d->items.emplace_back(LayerArena::make<Item>(obj));
   } else {
     return;
   }
-  d->keys[d->items.back()->id()] = d->items.size() - 1;
+  d->addKey();
+}
+
+void Item::addItem(const std::shared_ptr<Item> &item) {
+  d->items.push_back(item);
+  d->addKey();
 }
 
 std::shared_ptr<Item> Item::item(const std::string &id) const {
-  auto it = d->keys.find(id);
-  if (it != d->keys.end()) {
-    return d->items[it->second];
-  }
-  return std::shared_ptr<Item>();
+  return d->find(Atom::find(id), id);
+}
+
+std::shared_ptr<Item> Item::item(Atom id) const {
+  return d->find(id, id.str());
 }
 
 v8::Local<v8::Object> Item::itemObject(const std::string &id) const {
@@ -114,3 +189,15 @@ v8::Local<v8::Object> Item::itemObject(const std::string &id) const {
   }
   return v8::Local<v8::Object>();
 }
+
+void Item::serialize(std::ostream &os) const {
+  writeString(os, d->name);
+  writeString(os, id());
+  writeString(os, d->range);
+  writeString(os, d->summary);
+  d->value.serialize(os);
+  writeValue<uint32_t>(os, d->items.size());
+  for (const auto &item : d->items) {
+    item->serialize(os);
+  }
+}
@@ -1,8 +1,11 @@
 #ifndef ITEM_HPP
 #define ITEM_HPP
 
+#include "atom.hpp"
 #include "item_value.hpp"
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <v8.h>
@@ -13,29 +16,37 @@ public:
   Item();
   Item(const v8::FunctionCallbackInfo<v8::Value> &args);
   Item(v8::Local<v8::Value> value);
+  explicit Item(std::istream &is);
   Item(const Item &item);
   ~Item();
+  Item &operator=(const Item &) = delete;
 
-  std::string name() const;
+  const std::string &name() const;
   void setName(const std::string &name);
-  std::string id() const;
+  const std::string &id() const;
+  Atom idAtom() const;
   void setId(const std::string &id);
   std::string range() const;
   void setRange(const std::string &range);
   std::string summary() const;
   void setSummary(const std::string &summary);
   v8::Local<v8::Object> valueObject() const;
-  ItemValue value() const;
+  const ItemValue &value() const;
   void setValue(v8::Local<v8::Object> value);
+  void setValue(const ItemValue &value);
 
   std::vector<std::shared_ptr<Item>> items() const;
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const std::shared_ptr<Item> &item);
   std::shared_ptr<Item> item(const std::string &id) const;
+  std::shared_ptr<Item> item(Atom id) const;
   v8::Local<v8::Object> itemObject(const std::string &id) const;
 
+  void serialize(std::ostream &os) const;
+
 private:
   class Private;
-  std::unique_ptr<Private> d;
+  std::shared_ptr<Private> d;
 };
 
 #endif
@@ -1,6 +1,7 @@
 #include "item_value.hpp"
 #include "buffer.hpp"
 #include "large_buffer.hpp"
+#include "serialization.hpp"
 #include "session_large_buffer_wrapper.hpp"
 #include <memory>
 #include <nan.h>
@@ -11,7 +12,7 @@
 class ItemValue::Private {
 public:
   BaseType base = NUL;
-  double num;
+  double num = 0;
   std::string str;
   std::unique_ptr<Buffer> buf;
   std::unique_ptr<LargeBuffer> lbuf;
@@ -58,6 +59,36 @@ ItemValue::ItemValue(v8::Local<v8::Value> val) : ItemValue() {
   }
 }
 
+ItemValue::ItemValue(std::istream &is) : ItemValue() {
+  d->base = static_cast<BaseType>(readValue<uint8_t>(is));
+  d->num = readValue<double>(is);
+  d->str = readString(is);
+  d->type = readString(is);
+  d->buf = readBuffer(is);
+  if (readValue<bool>(is))
+    d->lbuf.reset(new LargeBuffer(is));
+}
+
+ItemValue::ItemValue(BaseType base, double num) : ItemValue() {
+  d->base = base;
+  d->num = num;
+}
+
+ItemValue::ItemValue(const std::string &str, const std::string &type)
+    : ItemValue() {
+  d->base = STRING;
+  d->str = str;
+  d->type = type;
+}
+
+ItemValue::ItemValue(std::unique_ptr<Buffer> buf) : ItemValue() {
+  if (buf) {
+    d->buf = std::move(buf);
+    d->buf->freeze();
+    d->base = BUFFER;
+  }
+}
+
 ItemValue::ItemValue(const ItemValue &value) : ItemValue() { *this = value; }
 
 ItemValue &ItemValue::operator=(const ItemValue &other) {
@@ -127,3 +158,22 @@ v8::Local<v8::Value> ItemValue::data() const {
 }
 
 std::string ItemValue::type() const { return d->type; }
+
+ItemValue::BaseType ItemValue::base() const { return d->base; }
+
+double ItemValue::num() const { return d->num; }
+
+const std::string &ItemValue::str() const { return d->str; }
+
+const Buffer *ItemValue::buffer() const { return d->buf.get(); }
+
+void ItemValue::serialize(std::ostream &os) const {
+  writeValue<uint8_t>(os, d->base);
+  writeValue<double>(os, d->num);
+  writeString(os, d->str);
+  writeString(os, d->type);
+  writeBuffer(os, d->buf.get());
+  writeValue<bool>(os, d->lbuf != nullptr);
+  if (d->lbuf)
+    d->lbuf->serialize(os);
+}
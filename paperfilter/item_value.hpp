@@ -1,7 +1,9 @@
 #ifndef ITEM_VALUE_HPP
 #define ITEM_VALUE_HPP
 
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <v8.h>
 
@@ -24,11 +26,21 @@ public:
   ItemValue();
   explicit ItemValue(const v8::FunctionCallbackInfo<v8::Value> &args);
   explicit ItemValue(v8::Local<v8::Value> val);
+  explicit ItemValue(std::istream &is);
+  ItemValue(BaseType base, double num);
+  explicit ItemValue(const std::string &str,
+                     const std::string &type = std::string());
+  explicit ItemValue(std::unique_ptr<Buffer> buf);
   ItemValue(const ItemValue &value);
   ItemValue &operator=(const ItemValue &);
   ~ItemValue();
   v8::Local<v8::Value> data() const;
   std::string type() const;
+  BaseType base() const;
+  double num() const;
+  const std::string &str() const;
+  const Buffer *buffer() const;
+  void serialize(std::ostream &os) const;
 
 private:
   class Private;
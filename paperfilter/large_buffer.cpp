@@ -1,5 +1,6 @@
 #include "large_buffer.hpp"
 #include "buffer.hpp"
+#include "serialization.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -60,6 +61,11 @@ public:
 
 LargeBuffer::LargeBuffer() : d(new Private) {}
 
+LargeBuffer::LargeBuffer(std::istream &is) : d(new Private) {
+  d->id = readString(is);
+  d->length = readValue<int>(is);
+}
+
 LargeBuffer::LargeBuffer(const LargeBuffer &other) : d(new Private) {
   *this = other;
 }
@@ -134,3 +140,8 @@ uint32_t LargeBuffer::length() const {
   d->ifs.seekg(0, std::ios::beg);
   return d->length;
 }
+
+void LargeBuffer::serialize(std::ostream &os) const {
+  writeString(os, d->id);
+  writeValue<int>(os, d->length);
+}
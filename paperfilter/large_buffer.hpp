@@ -1,7 +1,9 @@
 #ifndef LARGE_BUFFER_HPP
 #define LARGE_BUFFER_HPP
 
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
 #include <v8.h>
 #include <nan.h>
@@ -9,6 +11,7 @@
 class LargeBuffer {
 public:
   LargeBuffer();
+  explicit LargeBuffer(std::istream &is);
   ~LargeBuffer();
   LargeBuffer(const LargeBuffer &);
   LargeBuffer &operator=(const LargeBuffer &);
@@ -19,6 +22,7 @@ public:
   void get(uint32_t index,
            const Nan::PropertyCallbackInfo<v8::Value> &info) const;
   uint32_t length() const;
+  void serialize(std::ostream &os) const;
   static std::string tmpDir();
 
 private:
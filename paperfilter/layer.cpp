@@ -2,6 +2,8 @@
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "item.hpp"
+#include "layer_arena.hpp"
+#include "serialization.hpp"
 #include <v8pp/class.hpp>
 #include <v8pp/object.hpp>
 
@@ -9,29 +11,66 @@ using namespace v8;
 
 class Layer::Private {
 public:
-  std::string ns;
-  std::string name;
-  std::string id;
+  Atom ns;
+  Atom name;
+  Atom id;
   std::string summary;
   std::string range;
   double confidence = 1.0;
-  std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  LayerMap layers;
   std::weak_ptr<Packet> pkt;
-  std::vector<std::shared_ptr<Item>> items;
-  std::map<std::string, size_t> keys;
+  ArenaVector<std::shared_ptr<Item>> items;
+  ArenaMap<Atom, size_t> keys;
+  bool unkeyed = false;
   std::unique_ptr<Buffer> payload;
   std::unique_ptr<LargeBuffer> largePayload;
+
+public:
+  void addKey();
+  std::shared_ptr<Item> find(Atom atom, const std::string &str) const;
 };
 
-Layer::Layer(const std::string &ns) : d(std::make_shared<Private>()) {
-  d->ns = ns;
+// Items with overflow ids are not keyed and are found by a scan.
+void Layer::Private::addKey() {
+  Atom atom = items.back()->idAtom();
+  if (atom.valid()) {
+    keys[atom] = items.size() - 1;
+  } else {
+    unkeyed = true;
+  }
 }
 
-Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
+std::shared_ptr<Item> Layer::Private::find(Atom atom,
+                                           const std::string &str) const {
+  if (atom.valid()) {
+    auto it = keys.find(atom);
+    if (it != keys.end())
+      return items[it->second];
+  }
+  if (unkeyed) {
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+      if (!(*it)->idAtom().valid() && (*it)->id() == str)
+        return *it;
+    }
+  }
+  return std::shared_ptr<Item>();
+}
+
+Layer::Layer(const std::string &ns) : d(LayerArena::make<Private>()) {
+  d->ns = Atom(ns);
+}
+
+Layer::Layer(v8::Local<v8::Object> options) : d(LayerArena::make<Private>()) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  v8pp::get_option(isolate, options, "namespace", d->ns);
-  v8pp::get_option(isolate, options, "name", d->name);
-  v8pp::get_option(isolate, options, "id", d->id);
+  std::string ns;
+  std::string name;
+  std::string id;
+  v8pp::get_option(isolate, options, "namespace", ns);
+  v8pp::get_option(isolate, options, "name", name);
+  v8pp::get_option(isolate, options, "id", id);
+  d->ns = Atom(ns);
+  d->name = Atom(name);
+  d->id = Atom(id);
   v8pp::get_option(isolate, options, "summary", d->summary);
   v8pp::get_option(isolate, options, "range", d->range);
   v8pp::get_option(isolate, options, "confidence", d->confidence);
@@ -59,19 +98,44 @@ Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
   }
 }
 
+Layer::Layer(std::istream &is) : d(LayerArena::make<Private>()) {
+  d->ns = Atom(readString(is));
+  d->name = Atom(readString(is));
+  d->id = Atom(readString(is));
+  d->summary = readString(is);
+  d->range = readString(is);
+  d->confidence = readValue<double>(is);
+  uint32_t items = readValue<uint32_t>(is);
+  for (uint32_t i = 0; i < items && is; ++i) {
+    d->items.emplace_back(LayerArena::make<Item>(is));
+    d->addKey();
+  }
+  d->payload = readBuffer(is);
+  if (readValue<bool>(is))
+    d->largePayload.reset(new LargeBuffer(is));
+  uint32_t layers = readValue<uint32_t>(is);
+  for (uint32_t i = 0; i < layers && is; ++i) {
+    addLayer(LayerArena::make<Layer>(is));
+  }
+}
+
 Layer::~Layer() {}
 
-std::string Layer::ns() const { return d->ns; }
+const std::string &Layer::ns() const { return d->ns.str(); }
+
+Atom Layer::nsAtom() const { return d->ns; }
+
+void Layer::setNs(const std::string &ns) { d->ns = Atom(ns); }
 
-void Layer::setNs(const std::string &ns) { d->ns = ns; }
+const std::string &Layer::name() const { return d->name.str(); }
 
-std::string Layer::name() const { return d->name; }
+void Layer::setName(const std::string &name) { d->name = Atom(name); }
 
-void Layer::setName(const std::string &name) { d->name = name; }
+const std::string &Layer::id() const { return d->id.str(); }
 
-std::string Layer::id() const { return d->id; }
+Atom Layer::idAtom() const { return d->id; }
 
-void Layer::setId(const std::string &id) { d->id = id; }
+void Layer::setId(const std::string &id) { d->id = Atom(id); }
 
 std::string Layer::summary() const { return d->summary; };
 
@@ -86,19 +150,17 @@ double Layer::confidence() const { return d->confidence; }
 void Layer::setConfidence(double confidence) { d->confidence = confidence; }
 
 void Layer::addLayer(const std::shared_ptr<Layer> &layer) {
-  d->layers[layer->ns()] = std::move(layer);
+  d->layers[layer->nsAtom()] = std::move(layer);
 }
 
-std::unordered_map<std::string, std::shared_ptr<Layer>> &Layer::layers() const {
-  return d->layers;
-}
+LayerMap &Layer::layers() const { return d->layers; }
 
 v8::Local<v8::Object> Layer::layersObject() const {
   Isolate *isolate = Isolate::GetCurrent();
   v8::Local<v8::Object> obj = v8::Object::New(isolate);
   for (const auto &pair : d->layers) {
     obj->Set(
-        v8pp::to_v8(isolate, pair.first),
+        v8pp::to_v8(isolate, pair.first.str()),
         v8pp::class_<Layer>::reference_external(isolate, pair.second.get()));
   }
   return obj;
@@ -111,16 +173,23 @@ std::shared_ptr<Packet> Layer::packet() const { return d->pkt.lock(); }
 void Layer::addItem(v8::Local<v8::Object> obj) {
   Isolate *isolate = Isolate::GetCurrent();
   if (Item *item = v8pp::class_<Item>::unwrap_object(isolate, obj)) {
-    d->items.emplace_back(std::make_shared<Item>(*item));
+    d->items.emplace_back(LayerArena::make<Item>(*item));
   } else if (obj->IsObject()) {
-    d->items.emplace_back(std::make_shared<Item>(obj));
+    d->items.emplace_back(LayerArena::make<Item>(obj));
   } else {
     return;
   }
-  d->keys[d->items.back()->id()] = d->items.size() - 1;
+  d->addKey();
+}
+
+void Layer::addItem(const std::shared_ptr<Item> &item) {
+  d->items.push_back(item);
+  d->addKey();
 }
 
-std::vector<std::shared_ptr<Item>> Layer::items() const { return d->items; }
+std::vector<std::shared_ptr<Item>> Layer::items() const {
+  return std::vector<std::shared_ptr<Item>>(d->items.begin(), d->items.end());
+}
 
 std::unique_ptr<Buffer> Layer::payload() const {
   if (d->payload) {
@@ -130,11 +199,11 @@ std::unique_ptr<Buffer> Layer::payload() const {
 }
 
 std::shared_ptr<Item> Layer::item(const std::string &id) const {
-  auto it = d->keys.find(id);
-  if (it != d->keys.end()) {
-    return d->items[it->second];
-  }
-  return std::shared_ptr<Item>();
+  return d->find(Atom::find(id), id);
+}
+
+std::shared_ptr<Item> Layer::item(Atom id) const {
+  return d->find(id, id.str());
 }
 
 v8::Local<v8::Object> Layer::itemObject(const std::string &id) const {
@@ -181,3 +250,24 @@ v8::Local<v8::Object> Layer::payloadBuffer() const {
     return v8::Local<v8::Object>();
   }
 }
+
+void Layer::serialize(std::ostream &os) const {
+  writeString(os, d->ns.str());
+  writeString(os, d->name.str());
+  writeString(os, d->id.str());
+  writeString(os, d->summary);
+  writeString(os, d->range);
+  writeValue<double>(os, d->confidence);
+  writeValue<uint32_t>(os, d->items.size());
+  for (const auto &item : d->items) {
+    item->serialize(os);
+  }
+  writeBuffer(os, d->payload.get());
+  writeValue<bool>(os, d->largePayload != nullptr);
+  if (d->largePayload)
+    d->largePayload->serialize(os);
+  writeValue<uint32_t>(os, d->layers.size());
+  for (const auto &pair : d->layers) {
+    pair.second->serialize(os);
+  }
+}
@@ -1,9 +1,12 @@
 #ifndef LAYER_HPP
 #define LAYER_HPP
 
+#include "atom.hpp"
+#include "layer_arena.hpp"
+#include <istream>
 #include <memory>
+#include <ostream>
 #include <string>
-#include <unordered_map>
 #include <v8.h>
 #include <vector>
 
@@ -12,19 +15,27 @@ class Item;
 class ItemValue;
 class Buffer;
 class LargeBuffer;
+class Layer;
+
+typedef ArenaMap<Atom, std::shared_ptr<Layer>> LayerMap;
 
 class Layer {
 public:
   Layer(const std::string &ns);
   Layer(v8::Local<v8::Object> options);
+  explicit Layer(std::istream &is);
+  Layer(const Layer &layer) = default;
+  Layer(Layer &&layer) = default;
   ~Layer();
   Layer &operator=(const Layer &) = delete;
 
-  std::string ns() const;
+  const std::string &ns() const;
+  Atom nsAtom() const;
   void setNs(const std::string &ns);
-  std::string name() const;
+  const std::string &name() const;
   void setName(const std::string &name);
-  std::string id() const;
+  const std::string &id() const;
+  Atom idAtom() const;
   void setId(const std::string &name);
   std::string summary() const;
   void setSummary(const std::string &summary);
@@ -34,15 +45,17 @@ public:
   void setConfidence(double confidence);
 
   void addLayer(const std::shared_ptr<Layer> &layer);
-  std::unordered_map<std::string, std::shared_ptr<Layer>> &layers() const;
+  LayerMap &layers() const;
   v8::Local<v8::Object> layersObject() const;
 
   void setPacket(const std::shared_ptr<Packet> &pkt);
   std::shared_ptr<Packet> packet() const;
 
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const std::shared_ptr<Item> &item);
   std::vector<std::shared_ptr<Item>> items() const;
   std::shared_ptr<Item> item(const std::string &id) const;
+  std::shared_ptr<Item> item(Atom id) const;
   v8::Local<v8::Object> itemObject(const std::string &id) const;
 
   std::unique_ptr<Buffer> payload() const;
@@ -51,6 +64,8 @@ public:
   void setPayloadBuffer(v8::Local<v8::Object> obj);
   v8::Local<v8::Object> payloadBuffer() const;
 
+  void serialize(std::ostream &os) const;
+
 private:
   class Private;
   std::shared_ptr<Private> d;
@@ -0,0 +1,50 @@
+#include "layer_arena.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+const size_t initialBlockSize = 2048;
+const size_t maxBlockSize = 64 << 10;
+
+thread_local LayerArena *currentArena = nullptr;
+}
+
+class LayerArena::Private {
+public:
+  std::vector<std::unique_ptr<char[]>> blocks;
+  size_t blockSize = 0;
+  size_t offset = 0;
+  size_t reserved = 0;
+};
+
+LayerArena::Scope::Scope(LayerArena *arena) : prev(currentArena) {
+  currentArena = arena;
+}
+
+LayerArena::Scope::~Scope() { currentArena = prev; }
+
+LayerArena::LayerArena() : d(new Private()) {}
+
+LayerArena::~LayerArena() {}
+
+void *LayerArena::allocate(size_t size, size_t align) {
+  size_t offset = (d->offset + align - 1) & ~(align - 1);
+  if (d->blocks.empty() || offset + size > d->blockSize) {
+    size_t blockSize =
+        d->blocks.empty() ? initialBlockSize
+                          : std::min(d->blockSize * 2, maxBlockSize);
+    blockSize = std::max(blockSize, size + align);
+    d->blocks.emplace_back(new char[blockSize]);
+    d->blockSize = blockSize;
+    d->reserved += blockSize;
+    offset = 0;
+  }
+
+  // Blocks from new[] are aligned for any fundamental type.
+  d->offset = offset + size;
+  return d->blocks.back().get() + offset;
+}
+
+size_t LayerArena::size() const { return d->reserved; }
+
+LayerArena *LayerArena::current() { return currentArena; }
@@ -0,0 +1,110 @@
+#ifndef LAYER_ARENA_HPP
+#define LAYER_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// LayerArena is a bump allocator for the layers and items of one packet.
+// Nodes created with LayerArena::make() while a Scope is active are placed
+// in the arena together with their reference counts, and so are the
+// containers they own (see LayerArenaAllocator). The packet owns the arena
+// and releases it at once after its layers, so nodes must not outlive the
+// packet: references kept elsewhere hold the packet, not the node.
+class LayerArena {
+public:
+  class Scope {
+  public:
+    explicit Scope(LayerArena *arena);
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    LayerArena *prev;
+  };
+
+public:
+  LayerArena();
+  ~LayerArena();
+  LayerArena(const LayerArena &) = delete;
+  LayerArena &operator=(const LayerArena &) = delete;
+
+  void *allocate(size_t size, size_t align);
+  size_t size() const;
+
+  static LayerArena *current();
+  template <class T, class... Args>
+  static std::shared_ptr<T> make(Args &&... args);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+// A default-constructed allocator takes the arena of the active Scope, so
+// containers created while dissecting a packet live in its arena. Without
+// a Scope it falls back to the heap. Memory freed into an arena, such as
+// the old buckets of a rehashed map, is only reclaimed with the arena.
+template <class T> class LayerArenaAllocator {
+public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  LayerArenaAllocator() : arena(LayerArena::current()) {}
+  explicit LayerArenaAllocator(LayerArena *arena) : arena(arena) {}
+  template <class U>
+  LayerArenaAllocator(const LayerArenaAllocator<U> &other)
+      : arena(other.arena) {}
+
+  // Copies follow the active Scope rather than the source container.
+  LayerArenaAllocator select_on_container_copy_construction() const {
+    return LayerArenaAllocator();
+  }
+
+  T *allocate(size_t n) {
+    if (arena)
+      return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *ptr, size_t) {
+    if (!arena)
+      ::operator delete(ptr);
+  }
+
+  template <class U>
+  bool operator==(const LayerArenaAllocator<U> &other) const {
+    return arena == other.arena;
+  }
+  template <class U>
+  bool operator!=(const LayerArenaAllocator<U> &other) const {
+    return arena != other.arena;
+  }
+
+public:
+  LayerArena *arena;
+};
+
+template <class T>
+using ArenaVector = std::vector<T, LayerArenaAllocator<T>>;
+
+template <class K, class V>
+using ArenaMap =
+    std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+                       LayerArenaAllocator<std::pair<const K, V>>>;
+
+template <class T, class... Args>
+std::shared_ptr<T> LayerArena::make(Args &&... args) {
+  if (LayerArena *arena = current()) {
+    return std::allocate_shared<T>(LayerArenaAllocator<T>(arena),
+                                   std::forward<Args>(args)...);
+  }
+  return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+#endif
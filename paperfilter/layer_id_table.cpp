@@ -0,0 +1,50 @@
+#include "layer_id_table.hpp"
+#include "layer.hpp"
+#include <uv.h>
+
+class LayerIdTable::Private {
+public:
+  Private();
+  ~Private();
+
+public:
+  uv_rwlock_t rwlock;
+  std::unordered_map<Atom, uint64_t> bits;
+};
+
+LayerIdTable::Private::Private() { uv_rwlock_init(&rwlock); }
+
+LayerIdTable::Private::~Private() { uv_rwlock_destroy(&rwlock); }
+
+LayerIdTable::LayerIdTable() : d(new Private()) {}
+
+LayerIdTable::~LayerIdTable() {}
+
+uint64_t LayerIdTable::bit(const std::string &id) { return bit(Atom(id)); }
+
+uint64_t LayerIdTable::bit(Atom id) {
+  uv_rwlock_rdlock(&d->rwlock);
+  auto it = d->bits.find(id);
+  uint64_t bit = it != d->bits.end() ? it->second : 0;
+  uv_rwlock_rdunlock(&d->rwlock);
+  if (bit)
+    return bit;
+
+  uv_rwlock_wrlock(&d->rwlock);
+  size_t index = d->bits.size();
+  bit = index < 63 ? uint64_t(1) << index : overflowBit;
+  bit = d->bits.emplace(id, bit).first->second;
+  uv_rwlock_wrunlock(&d->rwlock);
+  return bit;
+}
+
+uint64_t LayerIdTable::mask(const LayerMap &layers) {
+  uint64_t mask = 0;
+  for (const auto &pair : layers) {
+    Atom id = pair.second->idAtom();
+    if (!id.empty())
+      mask |= bit(id);
+    mask |= this->mask(pair.second->layers());
+  }
+  return mask;
+}
@@ -0,0 +1,33 @@
+#ifndef LAYER_ID_TABLE_HPP
+#define LAYER_ID_TABLE_HPP
+
+#include "layer.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+
+// LayerIdTable assigns small integers to layer ids (e.g. "tcp") so that
+// the layers present in a packet fit into a 64-bit mask. Ids beyond the
+// first 63 share the overflow bit.
+class LayerIdTable {
+public:
+  static const uint64_t overflowBit = uint64_t(1) << 63;
+
+public:
+  LayerIdTable();
+  ~LayerIdTable();
+  LayerIdTable(const LayerIdTable &) = delete;
+  LayerIdTable &operator=(const LayerIdTable &) = delete;
+
+  uint64_t bit(const std::string &id);
+  uint64_t bit(Atom id);
+  uint64_t mask(const LayerMap &layers);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
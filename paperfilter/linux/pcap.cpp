@@ -1 +1,356 @@
-#include "../darwin/pcap.cpp"
+#include "pcap.hpp"
+#include "../packet.hpp"
+#include "../log_message.hpp"
+#include "../packet_batcher.hpp"
+#include "../slab_allocator.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <mutex>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <pcap.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+const unsigned int ringBlockSize = 1 << 22;
+const unsigned int ringBlockNum = 32;
+const unsigned int ringFrameSize = 1 << 11;
+const unsigned int ringBlockTimeout = 8; // msec
+const int pollTimeout = 100;             // msec
+const size_t macAddrsLen = 2 * ETH_ALEN;
+const size_t vlanTagLen = 4;
+}
+
+class Pcap::Private {
+public:
+  Private(const std::shared_ptr<Context> &ctx);
+  void log(const std::string &message,
+           LogMessage::Level level = LogMessage::LEVEL_ERROR) const;
+  bool open();
+  void close();
+  void loop();
+  void readBlock(const tpacket_block_desc *desc);
+
+public:
+  std::mutex mutex;
+  std::thread thread;
+  std::atomic<bool> closed;
+  int fd = -1;
+  uint8_t *ring = nullptr;
+  tpacket_req3 req;
+  SlabAllocator allocator;
+  std::vector<uint8_t> vlanFrame;
+
+  std::shared_ptr<Context> ctx;
+  bpf_program bpf = {0, nullptr};
+  std::string networkInterface;
+  bool promiscuous = false;
+  int snaplen = 2048;
+};
+
+Pcap::Private::Private(const std::shared_ptr<Context> &ctx)
+    : closed(true), ctx(ctx) {
+  std::memset(&req, 0, sizeof(req));
+}
+
+void Pcap::Private::log(const std::string &message,
+                        LogMessage::Level level) const {
+  if (ctx->logCb) {
+    LogMessage msg;
+    msg.level = level;
+    msg.message = message;
+    msg.domain = "pcap";
+    ctx->logCb(msg);
+  }
+}
+
+bool Pcap::Private::open() {
+  int ifindex = 0;
+  if (!networkInterface.empty()) {
+    ifindex = if_nametoindex(networkInterface.c_str());
+    if (ifindex == 0) {
+      log("if_nametoindex() failed: " + networkInterface);
+      return false;
+    }
+  }
+
+  fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+  if (fd < 0) {
+    log(std::string("socket() failed: ") + std::strerror(errno));
+    return false;
+  }
+
+  if (bpf.bf_len > 0) {
+    sock_fprog prog;
+    prog.len = bpf.bf_len;
+    prog.filter = reinterpret_cast<sock_filter *>(bpf.bf_insns);
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) <
+        0) {
+      log(std::string("setsockopt(SO_ATTACH_FILTER) failed: ") +
+          std::strerror(errno));
+      return false;
+    }
+  }
+
+  int version = TPACKET_V3;
+  if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) <
+      0) {
+    log(std::string("setsockopt(PACKET_VERSION) failed: ") +
+        std::strerror(errno));
+    return false;
+  }
+
+  std::memset(&req, 0, sizeof(req));
+  req.tp_block_size = ringBlockSize;
+  req.tp_block_nr = ringBlockNum;
+  req.tp_frame_size = ringFrameSize;
+  req.tp_frame_nr = (ringBlockSize * ringBlockNum) / ringFrameSize;
+  req.tp_retire_blk_tov = ringBlockTimeout;
+  if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    log(std::string("setsockopt(PACKET_RX_RING) failed: ") +
+        std::strerror(errno));
+    return false;
+  }
+
+  void *map = mmap(nullptr, req.tp_block_size * req.tp_block_nr,
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, fd, 0);
+  if (map == MAP_FAILED) {
+    map = mmap(nullptr, req.tp_block_size * req.tp_block_nr,
+               PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (map == MAP_FAILED) {
+    log(std::string("mmap() failed: ") + std::strerror(errno));
+    return false;
+  }
+  ring = static_cast<uint8_t *>(map);
+
+  sockaddr_ll addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sll_family = AF_PACKET;
+  addr.sll_protocol = htons(ETH_P_ALL);
+  addr.sll_ifindex = ifindex;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    log(std::string("bind() failed: ") + std::strerror(errno));
+    return false;
+  }
+
+  if (promiscuous && ifindex > 0) {
+    packet_mreq mreq;
+    std::memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = ifindex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq,
+                   sizeof(mreq)) < 0) {
+      log(std::string("setsockopt(PACKET_ADD_MEMBERSHIP) failed: ") +
+          std::strerror(errno));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Pcap::Private::close() {
+  if (fd >= 0) {
+    tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+    if (getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0 &&
+        stats.tp_drops > 0) {
+      log(std::to_string(stats.tp_drops) + " packets dropped by kernel",
+          LogMessage::LEVEL_WARN);
+    }
+  }
+  if (ring) {
+    munmap(ring, req.tp_block_size * req.tp_block_nr);
+    ring = nullptr;
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+void Pcap::Private::loop() {
+  pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN | POLLERR;
+  pfd.revents = 0;
+
+  unsigned int block = 0;
+  while (!closed) {
+    tpacket_block_desc *desc = reinterpret_cast<tpacket_block_desc *>(
+        ring + block * req.tp_block_size);
+    if (!(__atomic_load_n(&desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+          TP_STATUS_USER)) {
+      poll(&pfd, 1, pollTimeout);
+      continue;
+    }
+    readBlock(desc);
+    __atomic_store_n(&desc->hdr.bh1.block_status, TP_STATUS_KERNEL,
+                     __ATOMIC_RELEASE);
+    block = (block + 1) % req.tp_block_nr;
+  }
+}
+
+void Pcap::Private::readBlock(const tpacket_block_desc *desc) {
+  const uint8_t *base = reinterpret_cast<const uint8_t *>(desc);
+  uint32_t num = desc->hdr.bh1.num_pkts;
+  uint32_t offset = desc->hdr.bh1.offset_to_first_pkt;
+
+  std::vector<std::unique_ptr<Packet>> packets;
+  packets.reserve(num);
+  for (uint32_t i = 0; i < num; ++i) {
+    const tpacket3_hdr *hdr =
+        reinterpret_cast<const tpacket3_hdr *>(base + offset);
+    const sockaddr_ll *sll = reinterpret_cast<const sockaddr_ll *>(
+        base + offset + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+    offset += hdr->tp_next_offset;
+
+    // Frames sent over the loopback device are seen twice, once outgoing
+    // and once incoming; keep only the incoming copy like libpcap does.
+    if (sll->sll_pkttype == PACKET_OUTGOING &&
+        sll->sll_hatype == ARPHRD_LOOPBACK) {
+      continue;
+    }
+
+    const uint8_t *frame = reinterpret_cast<const uint8_t *>(hdr) + hdr->tp_mac;
+    uint32_t caplen = hdr->tp_snaplen;
+    uint32_t length = hdr->tp_len;
+
+    // The kernel strips the 802.1Q tag into the frame header when VLAN
+    // offload is enabled; put it back so dissectors see the wire format.
+    if ((hdr->tp_status & TP_STATUS_VLAN_VALID) &&
+        sll->sll_hatype == ARPHRD_ETHER && caplen >= macAddrsLen) {
+      uint16_t tpid = ETH_P_8021Q;
+#ifdef TP_STATUS_VLAN_TPID_VALID
+      if (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID) {
+        tpid = hdr->hv1.tp_vlan_tpid;
+      }
+#endif
+      uint16_t tci = hdr->hv1.tp_vlan_tci;
+      const uint8_t tag[vlanTagLen] = {
+          static_cast<uint8_t>(tpid >> 8), static_cast<uint8_t>(tpid),
+          static_cast<uint8_t>(tci >> 8), static_cast<uint8_t>(tci)};
+      vlanFrame.assign(frame, frame + macAddrsLen);
+      vlanFrame.insert(vlanFrame.end(), tag, tag + vlanTagLen);
+      vlanFrame.insert(vlanFrame.end(), frame + macAddrsLen, frame + caplen);
+      frame = vlanFrame.data();
+      caplen += vlanTagLen;
+      length += vlanTagLen;
+    }
+
+    caplen = std::min(caplen, static_cast<uint32_t>(snaplen));
+    packets.emplace_back(new Packet(hdr->tp_sec, hdr->tp_nsec, length, frame,
+                                    caplen, &allocator));
+  }
+
+  deliverPackets(*ctx, std::move(packets));
+}
+
+Pcap::Pcap(const std::shared_ptr<Context> &ctx) : d(new Private(ctx)) {}
+
+Pcap::~Pcap() { stop(); }
+
+std::vector<Pcap::Device> Pcap::devices() {
+  std::vector<Device> devs;
+
+  pcap_if_t *alldevsp;
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  if (pcap_findalldevs(&alldevsp, err) < 0) {
+    return devs;
+  }
+
+  for (pcap_if_t *ifs = alldevsp; ifs; ifs = ifs->next) {
+    Device dev;
+    dev.id = ifs->name;
+    dev.name = ifs->name;
+    if (ifs->description)
+      dev.description = ifs->description;
+    dev.loopback = ifs->flags & PCAP_IF_LOOPBACK;
+    dev.link = -1;
+
+    pcap_t *pcap = pcap_open_live(ifs->name, 1600, false, 0, err);
+    if (pcap) {
+      dev.link = pcap_datalink(pcap);
+      pcap_close(pcap);
+    }
+
+    devs.push_back(dev);
+  }
+
+  pcap_freealldevs(alldevsp);
+  return devs;
+}
+
+void Pcap::setInterface(const std::string &ifs) { d->networkInterface = ifs; }
+
+std::string Pcap::networkInterface() const { return d->networkInterface; }
+
+void Pcap::setPromiscuous(bool promisc) { d->promiscuous = promisc; }
+
+bool Pcap::promiscuous() const { return d->promiscuous; }
+
+void Pcap::setSnaplen(int len) { d->snaplen = len; }
+
+int Pcap::snaplen() const { return d->snaplen; }
+
+bool Pcap::setBPF(const std::string &filter, std::string *error) {
+  pcap_freecode(&d->bpf);
+  d->bpf.bf_len = 0;
+  d->bpf.bf_insns = nullptr;
+
+  if (filter.empty())
+    return true;
+
+  char err[PCAP_ERRBUF_SIZE] = {'\0'};
+  pcap_t *pcap = pcap_open_live(d->networkInterface.c_str(), d->snaplen,
+                                d->promiscuous, 1, err);
+  if (!pcap) {
+    if (error)
+      error->assign(err);
+    return false;
+  }
+
+  if (pcap_compile(pcap, &d->bpf, filter.c_str(), true, PCAP_NETMASK_UNKNOWN) <
+      0) {
+    if (error)
+      error->assign(pcap_geterr(pcap));
+    pcap_close(pcap);
+    return false;
+  }
+
+  pcap_close(pcap);
+  return true;
+}
+
+void Pcap::start() {
+  stop();
+
+  std::lock_guard<std::mutex> lock(d->mutex);
+  if (!d->open()) {
+    d->close();
+    return;
+  }
+
+  d->closed = false;
+  d->thread = std::thread([this]() { d->loop(); });
+}
+
+void Pcap::stop() {
+  d->closed = true;
+  if (d->thread.joinable())
+    d->thread.join();
+
+  std::lock_guard<std::mutex> lock(d->mutex);
+  d->close();
+}
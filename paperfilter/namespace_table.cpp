@@ -0,0 +1,174 @@
+#include "namespace_table.hpp"
+#include "console.hpp"
+#include "isolate_pool.hpp"
+#include "native_dissector.hpp"
+#include "paper_context.hpp"
+#include "script_cache.hpp"
+#include <algorithm>
+#include <nan.h>
+#include <thread>
+#include <unordered_map>
+#include <uv.h>
+#include <v8pp/class.hpp>
+#include <v8pp/context.hpp>
+#include <v8pp/object.hpp>
+
+class NamespaceTable::Private {
+public:
+  Private();
+  ~Private();
+  std::vector<size_t> match(Atom ns) const;
+
+public:
+  std::unordered_map<Atom, std::vector<size_t>> exact;
+  std::vector<std::pair<size_t, std::vector<std::regex>>> regexes;
+
+  // Matches of every namespace seen so far, shared by all threads. Entries
+  // are never removed, so each regex runs once per namespace and the
+  // references handed out by find() stay valid.
+  uv_rwlock_t rwlock;
+  std::unordered_map<Atom, std::vector<size_t>> matches;
+};
+
+NamespaceTable::Private::Private() { uv_rwlock_init(&rwlock); }
+
+NamespaceTable::Private::~Private() { uv_rwlock_destroy(&rwlock); }
+
+std::vector<size_t> NamespaceTable::Private::match(Atom ns) const {
+  std::vector<size_t> indices;
+  auto it = exact.find(ns);
+  if (it != exact.end())
+    indices = it->second;
+
+  const std::string &str = ns.str();
+  for (const auto &pair : regexes) {
+    if (std::find(indices.begin(), indices.end(), pair.first) !=
+        indices.end())
+      continue;
+    for (const std::regex &regex : pair.second) {
+      if (std::regex_match(str, regex)) {
+        indices.push_back(pair.first);
+        break;
+      }
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+NamespaceTable::NamespaceTable(const std::vector<Patterns> &dissectors)
+    : d(new Private()) {
+  for (size_t i = 0; i < dissectors.size(); ++i) {
+    for (const std::string &ns : dissectors[i].namespaces) {
+      std::vector<size_t> &indices = d->exact[Atom(ns)];
+      if (indices.empty() || indices.back() != i)
+        indices.push_back(i);
+    }
+    if (!dissectors[i].regexNamespaces.empty())
+      d->regexes.emplace_back(i, dissectors[i].regexNamespaces);
+  }
+  if (!d->regexes.empty()) {
+    for (const auto &pair : d->exact) {
+      d->matches.emplace(pair.first, d->match(pair.first));
+    }
+  }
+}
+
+NamespaceTable::~NamespaceTable() {}
+
+std::vector<NamespaceTable::Patterns>
+NamespaceTable::load(const std::vector<Dissector> &dissectors,
+                     const std::function<void(const LogMessage &)> &logCb) {
+  std::vector<Patterns> patterns(dissectors.size());
+  if (dissectors.empty())
+    return patterns;
+
+  // The calling thread has its own isolate entered, so the scripts run on
+  // a short-lived thread. The isolate goes back to the pool warm for the
+  // workers started next.
+  std::thread thread([&dissectors, &logCb, &patterns]() {
+    v8::Isolate *isolate = IsolatePool::acquire();
+    {
+      v8::Locker locker(isolate);
+      v8::Isolate::Scope isolate_scope(isolate);
+      v8::HandleScope handle_scope(isolate);
+      v8pp::context ppctx(isolate);
+      v8::TryCatch try_catch;
+      PaperContext::init(isolate);
+
+      v8::Local<v8::Object> console =
+          v8pp::class_<Console>::create_object(isolate, logCb, "dissector");
+      ppctx.set("console", console);
+
+      // Script errors are left to the worker threads to report.
+      for (size_t index = 0; index < dissectors.size(); ++index) {
+        const Dissector &diss = dissectors[index];
+        if (!diss.native.empty()) {
+          if (std::shared_ptr<NativeDissector> native =
+                  NativeDissector::create(diss.native)) {
+            patterns[index] = {native->namespaces(),
+                               native->regexNamespaces()};
+          }
+          continue;
+        }
+
+        v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
+        ppctx.set("module", moduleObj);
+
+        Nan::MaybeLocal<Nan::BoundScript> script = ScriptCache::compile(
+            isolate, "(function(){" + diss.script + "})()", diss.resourceName);
+        if (script.IsEmpty())
+          continue;
+        Nan::RunScript(script.ToLocalChecked());
+        v8::Local<v8::Value> result =
+            moduleObj->Get(v8::String::NewFromUtf8(isolate, "exports"));
+        if (result.IsEmpty() || !result->IsFunction())
+          continue;
+
+        v8::Local<v8::Array> namespaces;
+        if (!v8pp::get_option(isolate, result.As<v8::Object>(), "namespaces",
+                              namespaces))
+          continue;
+        for (uint32_t i = 0; i < namespaces->Length(); ++i) {
+          v8::Local<v8::Value> ns = namespaces->Get(i);
+          if (ns->IsString()) {
+            patterns[index].namespaces.push_back(
+                v8pp::from_v8<std::string>(isolate, ns, ""));
+          } else if (ns->IsRegExp()) {
+            patterns[index].regexNamespaces.push_back(
+                std::regex(v8pp::from_v8<std::string>(
+                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
+          }
+        }
+      }
+    }
+    IsolatePool::release(isolate);
+  });
+  thread.join();
+  return patterns;
+}
+
+const std::vector<size_t> &NamespaceTable::find(Atom ns) const {
+  if (d->regexes.empty()) {
+    static const std::vector<size_t> none;
+    auto it = d->exact.find(ns);
+    return it != d->exact.end() ? it->second : none;
+  }
+
+  const std::vector<size_t> *indices = nullptr;
+  uv_rwlock_rdlock(&d->rwlock);
+  auto it = d->matches.find(ns);
+  if (it != d->matches.end())
+    indices = &it->second;
+  uv_rwlock_rdunlock(&d->rwlock);
+  if (indices)
+    return *indices;
+
+  // Threads meeting a new namespace at once may both match it; the first
+  // insertion wins.
+  std::vector<size_t> matched = d->match(ns);
+  uv_rwlock_wrlock(&d->rwlock);
+  indices = &d->matches.emplace(ns, std::move(matched)).first->second;
+  uv_rwlock_wrunlock(&d->rwlock);
+  return *indices;
+}
@@ -0,0 +1,49 @@
+#ifndef NAMESPACE_TABLE_HPP
+#define NAMESPACE_TABLE_HPP
+
+#include "atom.hpp"
+#include "dissector.hpp"
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct LogMessage;
+
+// NamespaceTable maps layer namespaces (e.g. "::Ethernet::IPv4") to the
+// dissectors that handle them. A table is built once by the dispatcher
+// before its worker threads start and is shared by all of them. Namespaces
+// that regex patterns may match are resolved on their first lookup and
+// memoized in the table under a read-write lock.
+class NamespaceTable {
+public:
+  struct Patterns {
+    std::vector<std::string> namespaces;
+    std::vector<std::regex> regexNamespaces;
+  };
+
+public:
+  // |dissectors| holds the patterns of each dissector, in the order of the
+  // session's dissector list.
+  explicit NamespaceTable(const std::vector<Patterns> &dissectors);
+  ~NamespaceTable();
+  NamespaceTable(const NamespaceTable &) = delete;
+  NamespaceTable &operator=(const NamespaceTable &) = delete;
+
+  // Evaluates |dissectors| on a pooled isolate and collects the namespaces
+  // they declare. Blocks until done.
+  static std::vector<Patterns>
+  load(const std::vector<Dissector> &dissectors,
+       const std::function<void(const LogMessage &)> &logCb);
+
+  // Indices of the dissectors handling |ns|, in dissector order. The result
+  // stays valid as long as the table.
+  const std::vector<size_t> &find(Atom ns) const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
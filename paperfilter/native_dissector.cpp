@@ -0,0 +1,701 @@
+#include "native_dissector.hpp"
+#include "buffer.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "layer_arena.hpp"
+#include "packet.hpp"
+#include "stream_chunk.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+namespace {
+uint8_t readUInt8(const Buffer &buf, size_t offset) {
+  return static_cast<uint8_t>(*buf.data(offset));
+}
+
+uint16_t readUInt16BE(const Buffer &buf, size_t offset) {
+  return (readUInt8(buf, offset) << 8) | readUInt8(buf, offset + 1);
+}
+
+uint32_t readUInt32BE(const Buffer &buf, size_t offset) {
+  return (static_cast<uint32_t>(readUInt16BE(buf, offset)) << 16) |
+         readUInt16BE(buf, offset + 2);
+}
+
+std::string range(size_t start, size_t end) {
+  return std::to_string(start) + ":" + std::to_string(end);
+}
+
+std::string range(size_t start) { return std::to_string(start) + ":"; }
+
+ItemValue number(double num) { return ItemValue(ItemValue::NUMBER, num); }
+
+ItemValue boolean(bool value) { return ItemValue(ItemValue::BOOLEAN, value); }
+
+std::shared_ptr<Item> makeItem(const std::string &name, const std::string &id,
+                               const std::string &range,
+                               const ItemValue &value,
+                               const std::string &summary = std::string()) {
+  auto item = LayerArena::make<Item>();
+  item->setName(name);
+  item->setId(id);
+  item->setRange(range);
+  item->setValue(value);
+  item->setSummary(summary);
+  return item;
+}
+
+std::string enumName(const std::unordered_map<int, std::string> &table,
+                     int value) {
+  auto it = table.find(value);
+  if (it != table.end())
+    return it->second;
+  return "Unknown (" + std::to_string(value) + ")";
+}
+
+std::string flagNames(const std::vector<std::pair<std::string, int>> &table,
+                      int value) {
+  std::string names;
+  for (const auto &pair : table) {
+    if (value & pair.second) {
+      if (!names.empty())
+        names += ", ";
+      names += pair.first;
+    }
+  }
+  return names;
+}
+
+std::string macAddress(const Buffer &buf, size_t offset) {
+  char str[18];
+  std::snprintf(str, sizeof(str), "%02x:%02x:%02x:%02x:%02x:%02x",
+                readUInt8(buf, offset), readUInt8(buf, offset + 1),
+                readUInt8(buf, offset + 2), readUInt8(buf, offset + 3),
+                readUInt8(buf, offset + 4), readUInt8(buf, offset + 5));
+  return str;
+}
+
+std::string ipv4Address(const Buffer &buf, size_t offset) {
+  return std::to_string(readUInt8(buf, offset)) + "." +
+         std::to_string(readUInt8(buf, offset + 1)) + "." +
+         std::to_string(readUInt8(buf, offset + 2)) + "." +
+         std::to_string(readUInt8(buf, offset + 3));
+}
+
+std::string ipv6Address(const Buffer &buf, size_t offset) {
+  uint16_t groups[8];
+  for (int i = 0; i < 8; ++i) {
+    groups[i] = readUInt16BE(buf, offset + i * 2);
+  }
+
+  int zeroStart = -1;
+  int zeroLength = 0;
+  for (int i = 0; i < 8;) {
+    int j = i;
+    while (j < 8 && groups[j] == 0)
+      ++j;
+    if (j - i > zeroLength && j - i > 1) {
+      zeroStart = i;
+      zeroLength = j - i;
+    }
+    i = (j == i) ? i + 1 : j;
+  }
+
+  std::string str;
+  char group[5];
+  for (int i = 0; i < 8; ++i) {
+    if (i == zeroStart) {
+      str += (i == 0) ? "::" : ":";
+      i += zeroLength - 1;
+      continue;
+    }
+    std::snprintf(group, sizeof(group), "%x", groups[i]);
+    str += group;
+    if (i < 7)
+      str += ":";
+  }
+  return str;
+}
+
+ItemValue hostValue(const ItemValue &addr, uint16_t port) {
+  if (addr.type() == "dripcap/ipv4/addr") {
+    return ItemValue(addr.str() + ":" + std::to_string(port),
+                     "dripcap/ipv4/host");
+  } else if (addr.type() == "dripcap/ipv6/addr") {
+    return ItemValue("[" + addr.str() + "]:" + std::to_string(port),
+                     "dripcap/ipv6/host");
+  }
+  return ItemValue();
+}
+
+const std::unordered_map<int, std::string> &protocolTable() {
+  static const std::unordered_map<int, std::string> table = {
+    {0x00, "HOPOPT"}, {0x01, "ICMP"}, {0x02, "IGMP"}, {0x03, "GGP"},
+    {0x04, "IP-in-IP"}, {0x05, "ST"}, {0x06, "TCP"}, {0x07, "CBT"},
+    {0x08, "EGP"}, {0x09, "IGP"}, {0x0A, "BBN-RCC-MON"}, {0x0B, "NVP-II"},
+    {0x0C, "PUP"}, {0x0D, "ARGUS"}, {0x0E, "EMCON"}, {0x0F, "XNET"},
+    {0x10, "CHAOS"}, {0x11, "UDP"}, {0x12, "MUX"}, {0x13, "DCN-MEAS"},
+    {0x14, "HMP"}, {0x15, "PRM"}, {0x16, "XNS-IDP"}, {0x17, "TRUNK-1"},
+    {0x18, "TRUNK-2"}, {0x19, "LEAF-1"}, {0x1A, "LEAF-2"}, {0x1B, "RDP"},
+    {0x1C, "IRTP"}, {0x1D, "ISO-TP4"}, {0x1E, "NETBLT"}, {0x1F, "MFE-NSP"},
+    {0x20, "MERIT-INP"}, {0x21, "DCCP"}, {0x22, "3PC"}, {0x23, "IDPR"},
+    {0x24, "XTP"}, {0x25, "DDP"}, {0x26, "IDPR-CMTP"}, {0x27, "TP++"},
+    {0x28, "IL"}, {0x29, "IPv6"}, {0x2A, "SDRP"}, {0x2B, "Route"},
+    {0x2C, "Frag"}, {0x2D, "IDRP"}, {0x2E, "RSVP"}, {0x2F, "GRE"},
+    {0x30, "MHRP"}, {0x31, "BNA"}, {0x32, "ESP"}, {0x33, "AH"},
+    {0x34, "I-NLSP"}, {0x35, "SWIPE"}, {0x36, "NARP"}, {0x37, "MOBILE"},
+    {0x38, "TLSP"}, {0x39, "SKIP"}, {0x3A, "ICMP"}, {0x3B, "NoNxt"},
+    {0x3C, "Opts"}, {0x3E, "CFTP"}, {0x40, "SAT-EXPAK"}, {0x41, "KRYPTOLAN"},
+    {0x42, "RVD"}, {0x43, "IPPC"}, {0x45, "SAT-MON"}, {0x46, "VISA"},
+    {0x47, "IPCU"}, {0x48, "CPNX"}, {0x49, "CPHB"}, {0x4A, "WSN"},
+    {0x4B, "PVP"}, {0x4C, "BR-SAT-MON"}, {0x4D, "SUN-ND"}, {0x4E, "WB-MON"},
+    {0x4F, "WB-EXPAK"}, {0x50, "ISO-IP"}, {0x51, "VMTP"}, {0x52, "SECURE-VMTP"},
+    {0x53, "VINES"}, {0x54, "IPTM"}, {0x55, "NSFNET-IGP"}, {0x56, "DGP"},
+    {0x57, "TCF"}, {0x58, "EIGRP"}, {0x59, "OSPF"}, {0x5A, "Sprite-RPC"},
+    {0x5B, "LARP"}, {0x5C, "MTP"}, {0x5D, "AX.25"}, {0x5E, "IPIP"},
+    {0x5F, "MICP"}, {0x60, "SCC-SP"}, {0x61, "ETHERIP"}, {0x62, "ENCAP"},
+    {0x64, "GMTP"}, {0x65, "IFMP"}, {0x66, "PNNI"}, {0x67, "PIM"},
+    {0x68, "ARIS"}, {0x69, "SCPS"}, {0x6A, "QNX"}, {0x6B, "A/N"},
+    {0x6C, "IPComp"}, {0x6D, "SNP"}, {0x6E, "Compaq-Peer"}, {0x6F, "IPX-in-IP"},
+    {0x70, "VRRP"}, {0x71, "PGM"}, {0x73, "L2TP"}, {0x74, "DDX"},
+    {0x75, "IATP"}, {0x76, "STP"}, {0x77, "SRP"}, {0x78, "UTI"}, {0x79, "SMP"},
+    {0x7A, "SM"}, {0x7B, "PTP"}, {0x7C, "IS-IS"}, {0x7D, "FIRE"},
+    {0x7E, "CRTP"}, {0x7F, "CRUDP"}, {0x80, "SSCOPMCE"}, {0x81, "IPLT"},
+    {0x82, "SPS"}, {0x83, "PIPE"}, {0x84, "SCTP"}, {0x85, "FC"},
+    {0x86, "RSVP-E2E-IGNORE"}, {0x87, "RFC6275"}, {0x88, "UDPLite"},
+    {0x89, "MPLS-in-IP"}, {0x8A, "manet"}, {0x8B, "HIP"}, {0x8C, "Shim6"},
+    {0x8D, "WESP"}, {0x8E, "ROHC"}
+  };
+  return table;
+}
+
+class EthernetDissector : public NativeDissector {
+public:
+  std::vector<std::string> namespaces() const override {
+    return {"::<Ethernet>"};
+  }
+
+  void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    static const std::unordered_map<int, std::string> table = {
+        {0x0800, "IPv4"},      {0x0806, "ARP"},  {0x0842, "WoL"},
+        {0x809B, "AppleTalk"}, {0x80F3, "AARP"}, {0x86DD, "IPv6"}};
+
+    std::unique_ptr<Buffer> payload = parent->payload();
+    if (!payload || payload->length() < 14)
+      return;
+
+    auto layer = LayerArena::make<Layer>("::Ethernet");
+    layer->setName("Ethernet");
+    layer->setId("eth");
+
+    const std::string &destination = macAddress(*payload, 0);
+    layer->addItem(makeItem("Destination", "dst", "0:6",
+                            ItemValue(destination, "dripcap/mac")));
+
+    const std::string &source = macAddress(*payload, 6);
+    layer->addItem(
+        makeItem("Source", "src", "6:12", ItemValue(source, "dripcap/mac")));
+
+    std::string protocolName;
+    uint16_t type = readUInt16BE(*payload, 12);
+    if (type <= 1500) {
+      layer->addItem(makeItem("Length", "len", "12:14", number(type)));
+    } else {
+      const std::string &name = enumName(table, type);
+      auto etherType =
+          makeItem("EtherType", "etherType", "12:14", number(type), name);
+      etherType->addItem(makeItem("Name", "name", "12:14", ItemValue(name)));
+      layer->addItem(etherType);
+
+      if (table.count(type)) {
+        protocolName = name;
+        layer->setNs("::Ethernet::<" + protocolName + ">");
+      }
+    }
+
+    std::string summary = source + " -> " + destination;
+    if (!protocolName.empty()) {
+      summary = "[" + protocolName + "] " + summary;
+    }
+    layer->setSummary(summary);
+
+    layer->setRange("14:");
+    layer->setPayload(payload->slice(14));
+    layer->addItem(
+        makeItem("Payload", "payload", "14:", ItemValue(payload->slice(14))));
+
+    layers->push_back(layer);
+  }
+};
+
+class IPv4Dissector : public NativeDissector {
+public:
+  std::vector<std::string> namespaces() const override {
+    return {"::Ethernet::<IPv4>"};
+  }
+
+  void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    std::unique_ptr<Buffer> payload = parent->payload();
+    if (!payload || payload->length() < 20)
+      return;
+
+    auto layer = LayerArena::make<Layer>("::Ethernet::IPv4");
+    layer->setName("IPv4");
+    layer->setId("ipv4");
+
+    uint8_t version = readUInt8(*payload, 0) >> 4;
+    layer->addItem(makeItem("Version", "version", "0:1", number(version)));
+
+    uint8_t headerLength = readUInt8(*payload, 0) & 0b00001111;
+    layer->addItem(makeItem("Internet Header Length", "headerLength", "0:1",
+                            number(headerLength)));
+
+    uint8_t type = readUInt8(*payload, 1);
+    layer->addItem(makeItem("Type of service", "type", "1:2", number(type)));
+
+    uint16_t totalLength = readUInt16BE(*payload, 2);
+    layer->addItem(makeItem("Total Length", "totalLength", "2:4",
+                            number(totalLength)));
+
+    uint16_t id = readUInt16BE(*payload, 4);
+    layer->addItem(makeItem("Identification", "id", "4:6", number(id)));
+
+    static const std::vector<std::pair<std::string, int>> flagTable = {
+        {"Reserved", 0x1}, {"Don't Fragment", 0x2}, {"More Fragments", 0x4}};
+    uint8_t flagValue = (readUInt8(*payload, 6) >> 5) & 0x7;
+    auto flags = makeItem("Flags", "flags", "6:7", number(flagValue),
+                          flagNames(flagTable, flagValue));
+    flags->addItem(
+        makeItem("Reserved", "reserved", "6:7", boolean(flagValue & 0x1)));
+    flags->addItem(makeItem("Don't Fragment", "doNotFragment", "6:7",
+                            boolean(flagValue & 0x2)));
+    flags->addItem(makeItem("More Fragments", "moreFragments", "6:7",
+                            boolean(flagValue & 0x4)));
+    layer->addItem(flags);
+
+    uint16_t fragmentOffset = readUInt16BE(*payload, 6) & 0b0001111111111111;
+    layer->addItem(makeItem("Fragment Offset", "fragmentOffset", "6:8",
+                            number(fragmentOffset)));
+
+    uint8_t ttl = readUInt8(*payload, 8);
+    layer->addItem(makeItem("TTL", "ttl", "8:9", number(ttl)));
+
+    uint8_t protocolNumber = readUInt8(*payload, 9);
+    bool knownProtocol = protocolTable().count(protocolNumber) > 0;
+    const std::string &protocol = enumName(protocolTable(), protocolNumber);
+    auto protocolItem = makeItem("Protocol", "protocol", "9:10",
+                                 number(protocolNumber), protocol);
+    protocolItem->addItem(
+        makeItem("Name", "name", "9:10", ItemValue(protocol)));
+    layer->addItem(protocolItem);
+
+    if (knownProtocol) {
+      layer->setNs("::Ethernet::IPv4::<" + protocol + ">");
+    }
+
+    uint16_t checksum = readUInt16BE(*payload, 10);
+    layer->addItem(
+        makeItem("Header Checksum", "checksum", "10:12", number(checksum)));
+
+    const std::string &source = ipv4Address(*payload, 12);
+    layer->addItem(makeItem("Source IP Address", "src", "12:16",
+                            ItemValue(source, "dripcap/ipv4/addr")));
+
+    const std::string &destination = ipv4Address(*payload, 16);
+    layer->addItem(makeItem("Destination IP Address", "dst", "16:20",
+                            ItemValue(destination, "dripcap/ipv4/addr")));
+
+    size_t start = std::max<size_t>(20, headerLength * 4);
+    size_t end = std::min<size_t>(totalLength, payload->length());
+    end = std::max(start, end);
+    layer->setRange(range(start, end));
+    layer->setPayload(payload->slice(start, end));
+    layer->addItem(makeItem("Payload", "payload", range(start, end),
+                            ItemValue(payload->slice(start, end))));
+
+    std::string summary = source + " -> " + destination;
+    if (knownProtocol) {
+      summary = "[" + protocol + "] " + summary;
+    }
+    layer->setSummary(summary);
+
+    layers->push_back(layer);
+  }
+};
+
+class IPv6Dissector : public NativeDissector {
+public:
+  std::vector<std::string> namespaces() const override {
+    return {"::Ethernet::<IPv6>"};
+  }
+
+  void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    std::unique_ptr<Buffer> payload = parent->payload();
+    if (!payload || payload->length() < 40)
+      return;
+
+    auto layer = LayerArena::make<Layer>("::Ethernet::IPv6");
+    layer->setName("IPv6");
+    layer->setId("ipv6");
+
+    uint8_t version = readUInt8(*payload, 0) >> 4;
+    layer->addItem(makeItem("Version", "version", "0:1", number(version)));
+
+    uint8_t trafficClass = ((readUInt8(*payload, 0) & 0b00001111) << 4) |
+                           ((readUInt8(*payload, 1) & 0b11110000) >> 4);
+    layer->addItem(makeItem("Traffic Class", "trafficClass", "0:2",
+                            number(trafficClass)));
+
+    uint32_t flowLevel = readUInt16BE(*payload, 2) |
+                         ((readUInt8(*payload, 1) & 0b00001111) << 16);
+    layer->addItem(
+        makeItem("Flow Label", "flowLevel", "1:4", number(flowLevel)));
+
+    uint16_t payloadLength = readUInt16BE(*payload, 4);
+    layer->addItem(makeItem("Payload Length", "payloadLength", "4:6",
+                            number(payloadLength)));
+
+    uint8_t nextHeader = readUInt8(*payload, 6);
+    std::string nextHeaderRange = "6:7";
+    layer->addItem(
+        makeItem("Next Header", "", nextHeaderRange, number(nextHeader)));
+
+    uint8_t hopLimit = readUInt8(*payload, 7);
+    layer->addItem(makeItem("Hop Limit", "hopLimit", "7:8", number(hopLimit)));
+
+    const std::string &source = ipv6Address(*payload, 8);
+    layer->addItem(makeItem("Source IP Address", "src", "8:24",
+                            ItemValue(source, "dripcap/ipv6/addr")));
+
+    const std::string &destination = ipv6Address(*payload, 24);
+    layer->addItem(makeItem("Destination IP Address", "dst", "24:40",
+                            ItemValue(destination, "dripcap/ipv6/addr")));
+
+    size_t offset = 40;
+    // Hop-by-Hop Options and Destination Options are decoded; any other
+    // extension header ends the chain, as in the JS dissector.
+    while ((nextHeader == 0 || nextHeader == 60) &&
+           offset + 2 <= payload->length()) {
+      size_t extLen = (readUInt8(*payload, offset + 1) + 1) * 8;
+      if (offset + extLen > payload->length())
+        break;
+      const char *name =
+          (nextHeader == 0) ? "Hop-by-Hop Options" : "Destination Options";
+
+      nextHeader = readUInt8(*payload, offset);
+      nextHeaderRange = range(offset, offset + 1);
+
+      auto item =
+          makeItem(name, "", range(offset, offset + extLen), ItemValue());
+      item->addItem(
+          makeItem("Next Header", "", nextHeaderRange, number(nextHeader)));
+      item->addItem(makeItem("Hdr Ext Len", "", range(offset + 1, offset + 2),
+                             number(readUInt8(*payload, offset + 1))));
+      item->addItem(makeItem(
+          "Options and Padding", "", range(offset + 2, offset + extLen),
+          ItemValue(payload->slice(offset + 2, offset + extLen))));
+      layer->addItem(item);
+
+      offset += extLen;
+    }
+
+    bool knownProtocol = protocolTable().count(nextHeader) > 0;
+    const std::string &protocol = enumName(protocolTable(), nextHeader);
+    if (knownProtocol) {
+      layer->setNs("::Ethernet::IPv6::<" + protocol + ">");
+    }
+
+    auto protocolItem = makeItem("Protocol", "protocol", nextHeaderRange,
+                                 number(nextHeader), protocol);
+    protocolItem->addItem(
+        makeItem("Name", "name", nextHeaderRange, ItemValue(protocol)));
+    layer->addItem(protocolItem);
+
+    layer->setRange(range(offset));
+    layer->setPayload(payload->slice(offset));
+    layer->addItem(makeItem("Payload", "payload", range(offset),
+                            ItemValue(payload->slice(offset))));
+
+    std::string summary = source + " -> " + destination;
+    if (knownProtocol) {
+      summary = "[" + protocol + "] " + summary;
+    }
+    layer->setSummary(summary);
+
+    layers->push_back(layer);
+  }
+};
+
+class TCPDissector : public NativeDissector {
+public:
+  std::vector<std::regex> regexNamespaces() const override {
+    return {std::regex(R"(::Ethernet::\w+::<TCP>)")};
+  }
+
+  void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    std::unique_ptr<Buffer> payload = parent->payload();
+    if (!payload || payload->length() < 20)
+      return;
+
+    std::string ns = parent->ns();
+    size_t pos = ns.find("<TCP>");
+    if (pos != std::string::npos)
+      ns.replace(pos, 5, "TCP");
+
+    auto layer = LayerArena::make<Layer>(ns);
+    layer->setName("TCP");
+    layer->setId("tcp");
+
+    uint16_t source = readUInt16BE(*payload, 0);
+    layer->addItem(
+        makeItem("Source port", "srcPort", "0:2", number(source)));
+
+    uint16_t destination = readUInt16BE(*payload, 2);
+    layer->addItem(makeItem("Destination port", "dstPort", "2:4",
+                            number(destination)));
+
+    std::string src;
+    std::string dst;
+    if (std::shared_ptr<Item> srcAddr = parent->item("src")) {
+      const ItemValue &value = hostValue(srcAddr->value(), source);
+      src = value.str();
+      layer->addItem(makeItem("", "src", "", value));
+    }
+    if (std::shared_ptr<Item> dstAddr = parent->item("dst")) {
+      const ItemValue &value = hostValue(dstAddr->value(), destination);
+      dst = value.str();
+      layer->addItem(makeItem("", "dst", "", value));
+    }
+
+    uint32_t seq = readUInt32BE(*payload, 4);
+    layer->addItem(makeItem("Sequence number", "seq", "4:8", number(seq)));
+
+    uint32_t ack = readUInt32BE(*payload, 8);
+    layer->addItem(
+        makeItem("Acknowledgment number", "ack", "8:12", number(ack)));
+
+    uint8_t dataOffset = readUInt8(*payload, 12) >> 4;
+    layer->addItem(
+        makeItem("Data offset", "dataOffset", "12:13", number(dataOffset)));
+
+    static const std::vector<std::pair<std::string, int>> flagTable = {
+        {"NS", 0x1 << 8},  {"CWR", 0x1 << 7}, {"ECE", 0x1 << 6},
+        {"URG", 0x1 << 5}, {"ACK", 0x1 << 4}, {"PSH", 0x1 << 3},
+        {"RST", 0x1 << 2}, {"SYN", 0x1 << 1}, {"FIN", 0x1 << 0}};
+    uint16_t flagValue =
+        readUInt8(*payload, 13) | ((readUInt8(*payload, 12) & 0x1) << 8);
+    auto flags = makeItem("Flags", "flags", "12:14", number(flagValue),
+                          flagNames(flagTable, flagValue));
+    for (const auto &pair : flagTable) {
+      flags->addItem(makeItem(pair.first, pair.first,
+                              pair.first == "NS" ? "12:13" : "13:14",
+                              boolean(flagValue & pair.second)));
+    }
+    layer->addItem(flags);
+
+    uint16_t window = readUInt16BE(*payload, 14);
+    layer->addItem(makeItem("Window size", "window", "14:16", number(window)));
+
+    uint16_t checksum = readUInt16BE(*payload, 16);
+    layer->addItem(makeItem("Checksum", "checksum", "16:18", number(checksum)));
+
+    uint16_t urgent = readUInt16BE(*payload, 18);
+    layer->addItem(
+        makeItem("Urgent pointer", "urgent", "18:20", number(urgent)));
+
+    size_t optionDataOffset =
+        std::min<size_t>(dataOffset * 4, payload->length());
+    auto options =
+        makeItem("Options", "", range(20, optionDataOffset), ItemValue());
+    std::string optionNames;
+    auto addOption = [&options, &optionNames](
+        const std::shared_ptr<Item> &item) {
+      if (!optionNames.empty())
+        optionNames += ",";
+      optionNames += item->name();
+      options->addItem(item);
+    };
+
+    size_t optionOffset = 20;
+    while (optionDataOffset > optionOffset) {
+      size_t left = optionDataOffset - optionOffset;
+      uint8_t kind = readUInt8(*payload, optionOffset);
+      if (kind == 0) {
+        break;
+      } else if (kind == 1) {
+        options->addItem(makeItem("NOP", "", range(optionOffset,
+                                                   optionOffset + 1),
+                                  ItemValue()));
+        optionOffset++;
+      } else if (kind == 2 && left >= 4) {
+        addOption(makeItem("Maximum segment size", "",
+                           range(optionOffset, optionOffset + 4),
+                           number(readUInt16BE(*payload, optionOffset + 2))));
+        optionOffset += 4;
+      } else if (kind == 3 && left >= 3) {
+        addOption(makeItem("Window scale", "",
+                           range(optionOffset, optionOffset + 3),
+                           number(readUInt8(*payload, optionOffset + 2))));
+        optionOffset += 3;
+      } else if (kind == 4 && left >= 2) {
+        addOption(makeItem("Selective ACK permitted", "",
+                           range(optionOffset, optionOffset + 2),
+                           ItemValue()));
+        optionOffset += 2;
+      } else if (kind == 5 && left >= 2 &&
+                 readUInt8(*payload, optionOffset + 1) >= 2 &&
+                 readUInt8(*payload, optionOffset + 1) <= left) {
+        uint8_t length = readUInt8(*payload, optionOffset + 1);
+        addOption(makeItem("Selective ACK", "",
+                           range(optionOffset, optionOffset + length),
+                           ItemValue(payload->slice(optionOffset + 2,
+                                                    optionOffset + length))));
+        optionOffset += length;
+      } else if (kind == 8 && left >= 10) {
+        uint32_t mt = readUInt32BE(*payload, optionOffset + 2);
+        uint32_t et = readUInt32BE(*payload, optionOffset + 6);
+        auto item = makeItem(
+            "Timestamps", "", range(optionOffset, optionOffset + 10),
+            ItemValue(std::to_string(mt) + " - " + std::to_string(et)));
+        item->addItem(makeItem("My timestamp", "",
+                               range(optionOffset + 2, optionOffset + 6),
+                               number(mt)));
+        item->addItem(makeItem("Echo reply timestamp", "",
+                               range(optionOffset + 6, optionOffset + 10),
+                               number(et)));
+        addOption(item);
+        optionOffset += 10;
+      } else {
+        // Unknown or truncated option; the rest cannot be decoded.
+        break;
+      }
+    }
+    options->setValue(ItemValue(optionNames));
+    layer->addItem(options);
+
+    layer->setRange(range(optionDataOffset));
+    layer->setPayload(payload->slice(optionDataOffset));
+    layer->addItem(makeItem("Payload", "payload", range(optionDataOffset),
+                            ItemValue(payload->slice(optionDataOffset))));
+
+    layer->setSummary(src + " -> " + dst + " seq:" + std::to_string(seq) +
+                      " ack:" + std::to_string(ack));
+
+    std::unique_ptr<StreamChunk> chunk(
+        new StreamChunk(parent->ns(), src + "/" + dst));
+    chunk->setLayer(layer);
+    chunk->setAttr("payload", ItemValue(payload->slice(optionDataOffset)));
+    chunk->setAttr("seq", number(seq));
+    if ((flagValue & (0x1 << 4)) && (flagValue & 0x1)) {
+      chunk->setEnd(true);
+    }
+
+    layers->push_back(layer);
+    streams->push_back(std::move(chunk));
+  }
+};
+
+class UDPDissector : public NativeDissector {
+public:
+  std::vector<std::regex> regexNamespaces() const override {
+    return {std::regex(R"(::Ethernet::\w+::<UDP>)")};
+  }
+
+  void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    std::unique_ptr<Buffer> payload = parent->payload();
+    if (!payload || payload->length() < 8)
+      return;
+
+    std::string ns = parent->ns();
+    size_t pos = ns.find("<UDP>");
+    if (pos != std::string::npos)
+      ns.replace(pos, 5, "UDP");
+
+    auto layer = LayerArena::make<Layer>(ns);
+    layer->setName("UDP");
+    layer->setId("udp");
+
+    uint16_t source = readUInt16BE(*payload, 0);
+    layer->addItem(
+        makeItem("Source port", "srcPort", "0:2", number(source)));
+
+    uint16_t destination = readUInt16BE(*payload, 2);
+    layer->addItem(makeItem("Destination port", "dstPort", "2:4",
+                            number(destination)));
+
+    std::string src;
+    std::string dst;
+    if (std::shared_ptr<Item> srcAddr = parent->item("src")) {
+      const ItemValue &value = hostValue(srcAddr->value(), source);
+      src = value.str();
+      layer->addItem(makeItem("", "src", "", value));
+    }
+    if (std::shared_ptr<Item> dstAddr = parent->item("dst")) {
+      const ItemValue &value = hostValue(dstAddr->value(), destination);
+      dst = value.str();
+      layer->addItem(makeItem("", "dst", "", value));
+    }
+
+    uint16_t length = readUInt16BE(*payload, 4);
+    layer->addItem(makeItem("Length", "len", "4:6", number(length)));
+
+    uint16_t checksum = readUInt16BE(*payload, 6);
+    layer->addItem(makeItem("Checksum", "checksum", "6:8", number(checksum)));
+
+    size_t end = std::max<size_t>(
+        8, std::min<size_t>(length, payload->length()));
+    layer->setRange(range(8, end));
+    layer->setPayload(payload->slice(8, end));
+    layer->addItem(makeItem("Payload", "payload", range(8, end),
+                            ItemValue(payload->slice(8, end))));
+
+    layer->setSummary(src + " -> " + dst);
+
+    layers->push_back(layer);
+  }
+};
+}
+
+NativeDissector::~NativeDissector() {}
+
+std::vector<std::string> NativeDissector::namespaces() const {
+  return std::vector<std::string>();
+}
+
+std::vector<std::regex> NativeDissector::regexNamespaces() const {
+  return std::vector<std::regex>();
+}
+
+std::unique_ptr<NativeDissector>
+NativeDissector::create(const std::string &name) {
+  NativeDissector *diss = nullptr;
+  if (name == "ethernet") {
+    diss = new EthernetDissector();
+  } else if (name == "ipv4") {
+    diss = new IPv4Dissector();
+  } else if (name == "ipv6") {
+    diss = new IPv6Dissector();
+  } else if (name == "tcp") {
+    diss = new TCPDissector();
+  } else if (name == "udp") {
+    diss = new UDPDissector();
+  }
+  return std::unique_ptr<NativeDissector>(diss);
+}
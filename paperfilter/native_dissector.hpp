@@ -0,0 +1,27 @@
+#ifndef NATIVE_DISSECTOR_HPP
+#define NATIVE_DISSECTOR_HPP
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+class Packet;
+class Layer;
+class StreamChunk;
+
+class NativeDissector {
+public:
+  virtual ~NativeDissector();
+  virtual std::vector<std::string> namespaces() const;
+  virtual std::vector<std::regex> regexNamespaces() const;
+  virtual void analyze(const Packet &pkt, const std::shared_ptr<Layer> &parent,
+                       std::vector<std::shared_ptr<Layer>> *layers,
+                       std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const = 0;
+
+public:
+  static std::unique_ptr<NativeDissector> create(const std::string &name);
+};
+
+#endif
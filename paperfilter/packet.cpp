@@ -2,7 +2,11 @@
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "layer.hpp"
+#include "layer_arena.hpp"
+#include "serialization.hpp"
 #include "session_item_value_wrapper.hpp"
+#include "slab_allocator.hpp"
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <node_buffer.h>
@@ -11,8 +15,7 @@
 #include <v8pp/object.hpp>
 
 namespace {
-std::shared_ptr<Layer> leafLayer(
-    const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers) {
+std::shared_ptr<Layer> leafLayer(const LayerMap &layers) {
   if (layers.empty())
     return std::shared_ptr<Layer>();
   std::shared_ptr<Layer> layer;
@@ -28,6 +31,13 @@ std::shared_ptr<Layer> leafLayer(
     return layer;
   }
 }
+
+void setPacket(const LayerMap &layers, const std::shared_ptr<Packet> &pkt) {
+  for (const auto &pair : layers) {
+    pair.second->setPacket(pkt);
+    setPacket(pair.second->layers(), pkt);
+  }
+}
 }
 
 using namespace v8;
@@ -43,12 +53,18 @@ public:
   uint32_t ts_nsec = 0;
   uint32_t length = 0;
   bool vpacket = false;
+  std::atomic<bool> dissected;
+  uint64_t layerMask = 0;
+  std::mutex mutex;
   std::unique_ptr<Buffer> payload;
+  size_t slabBytes = 0;
   std::unique_ptr<LargeBuffer> largePayload;
-  std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  // Declared before |layers| so that the nodes are gone before the arena.
+  std::unique_ptr<LayerArena> arena;
+  LayerMap layers;
 };
 
-Packet::Private::Private() {}
+Packet::Private::Private() : dissected(false) {}
 
 Packet::Private::~Private() {}
 
@@ -82,14 +98,26 @@ Packet::Packet(std::unique_ptr<Layer> layer) : d(new Private()) {
   d->vpacket = true;
 }
 
-Packet::Packet(const struct pcap_pkthdr *h, const uint8_t *bytes)
+Packet::Packet(const struct pcap_pkthdr *h, const uint8_t *bytes,
+               SlabAllocator *allocator)
+    : Packet(h->ts.tv_sec, h->ts.tv_usec * 1000, h->len, bytes, h->caplen,
+             allocator) {}
+
+Packet::Packet(uint32_t tsSec, uint32_t tsNsec, uint32_t length,
+               const uint8_t *bytes, uint32_t caplen, SlabAllocator *allocator)
     : d(new Private()) {
-  d->ts_sec = h->ts.tv_sec;
-  d->ts_nsec = h->ts.tv_usec;
-  d->length = h->len;
-  auto buffer = std::make_shared<std::vector<char>>();
-  buffer->assign(bytes, bytes + h->caplen);
-  d->payload.reset(new Buffer(buffer));
+  d->ts_sec = tsSec;
+  d->ts_nsec = tsNsec;
+  d->length = length;
+  if (allocator) {
+    d->payload =
+        allocator->copy(reinterpret_cast<const char *>(bytes), caplen);
+    d->slabBytes = allocator->footprint(caplen);
+  } else {
+    auto buffer = std::make_shared<std::vector<char>>();
+    buffer->assign(bytes, bytes + caplen);
+    d->payload.reset(new Buffer(buffer));
+  }
   d->payload->freeze();
 }
 
@@ -113,6 +141,16 @@ std::string Packet::summary() const {
 
 bool Packet::vpacket() const { return d->vpacket; }
 
+bool Packet::dissected() const { return d->dissected; }
+
+void Packet::setDissected(bool dissected) { d->dissected = dissected; }
+
+uint64_t Packet::layerMask() const { return d->layerMask; }
+
+void Packet::setLayerMask(uint64_t mask) { d->layerMask = mask; }
+
+std::mutex &Packet::mutex() const { return d->mutex; }
+
 uint32_t Packet::length() const { return d->length; }
 
 std::unique_ptr<Buffer> Packet::payload() const {
@@ -162,7 +200,8 @@ double Packet::confidence() const {
 
 v8::Local<v8::Value> Packet::timestamp() const {
   Isolate *isolate = Isolate::GetCurrent();
-  return v8::Date::New(isolate, (d->ts_sec * 1000.0) + (d->ts_nsec / 1000.0));
+  return v8::Date::New(isolate,
+                       (d->ts_sec * 1000.0) + (d->ts_nsec / 1000000.0));
 }
 
 v8::Local<v8::Object> Packet::payloadBuffer() const {
@@ -178,12 +217,28 @@ v8::Local<v8::Object> Packet::payloadBuffer() const {
 }
 
 void Packet::addLayer(const std::shared_ptr<Layer> &layer) {
-  d->layers[layer->ns()] = layer;
+  d->layers[layer->nsAtom()] = layer;
 }
 
-const std::unordered_map<std::string, std::shared_ptr<Layer>> &
-Packet::layers() const {
-  return d->layers;
+const LayerMap &Packet::layers() const { return d->layers; }
+
+LayerArena *Packet::arena() {
+  if (!d->arena)
+    d->arena.reset(new LayerArena());
+  return d->arena.get();
+}
+
+size_t Packet::memoryUsage() const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  size_t usage = sizeof(Packet) + sizeof(Private);
+  if (d->slabBytes > 0) {
+    usage += d->slabBytes;
+  } else if (d->payload) {
+    usage += d->payload->length();
+  }
+  if (d->arena)
+    usage += d->arena->size();
+  return usage;
 }
 
 v8::Local<v8::Object> Packet::layersObject() const {
@@ -191,7 +246,7 @@ v8::Local<v8::Object> Packet::layersObject() const {
   v8::Local<v8::Object> obj = v8::Object::New(isolate);
   for (const auto &pair : d->layers) {
     obj->Set(
-        v8pp::to_v8(isolate, pair.first),
+        v8pp::to_v8(isolate, pair.first.str()),
         v8pp::class_<Layer>::reference_external(isolate, pair.second.get()));
   }
   return obj;
@@ -212,3 +267,45 @@ std::unique_ptr<Packet> Packet::shallowClone() {
   }
   return pkt;
 }
+
+void Packet::serialize(std::ostream &os) const {
+  std::lock_guard<std::mutex> lock(d->mutex);
+  writeValue<uint32_t>(os, d->seq);
+  writeValue<uint32_t>(os, d->ts_sec);
+  writeValue<uint32_t>(os, d->ts_nsec);
+  writeValue<uint32_t>(os, d->length);
+  writeValue<bool>(os, d->vpacket);
+  writeValue<bool>(os, d->dissected);
+  writeValue<uint64_t>(os, d->layerMask);
+  writeBuffer(os, d->payload.get());
+  writeValue<bool>(os, d->largePayload != nullptr);
+  if (d->largePayload)
+    d->largePayload->serialize(os);
+  writeValue<uint32_t>(os, d->layers.size());
+  for (const auto &pair : d->layers) {
+    pair.second->serialize(os);
+  }
+}
+
+std::shared_ptr<Packet> Packet::deserialize(std::istream &is) {
+  std::shared_ptr<Packet> pkt(new Packet());
+  pkt->d->seq = readValue<uint32_t>(is);
+  pkt->d->ts_sec = readValue<uint32_t>(is);
+  pkt->d->ts_nsec = readValue<uint32_t>(is);
+  pkt->d->length = readValue<uint32_t>(is);
+  pkt->d->vpacket = readValue<bool>(is);
+  pkt->d->dissected = readValue<bool>(is);
+  pkt->d->layerMask = readValue<uint64_t>(is);
+  pkt->d->payload = readBuffer(is);
+  if (readValue<bool>(is))
+    pkt->d->largePayload.reset(new LargeBuffer(is));
+  uint32_t layers = readValue<uint32_t>(is);
+  LayerArena::Scope arenaScope(pkt->arena());
+  for (uint32_t i = 0; i < layers && is; ++i) {
+    pkt->addLayer(LayerArena::make<Layer>(is));
+  }
+  if (!is)
+    return std::shared_ptr<Packet>();
+  setPacket(pkt->d->layers, pkt);
+  return pkt;
+}
@@ -1,22 +1,30 @@
 #ifndef PACKET_HPP
 #define PACKET_HPP
 
+#include "layer.hpp"
+#include <istream>
 #include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <v8.h>
 #include <vector>
 
-class Layer;
 class Buffer;
+class LayerArena;
 class LargeBuffer;
+class SlabAllocator;
 struct pcap_pkthdr;
 
 class Packet {
 public:
   Packet(v8::Local<v8::Object> option);
   Packet(std::unique_ptr<Layer> layer);
-  Packet(const struct pcap_pkthdr *h, const uint8_t *bytes);
+  Packet(const struct pcap_pkthdr *h, const uint8_t *bytes,
+         SlabAllocator *allocator = nullptr);
+  Packet(uint32_t tsSec, uint32_t tsNsec, uint32_t length, const uint8_t *bytes,
+         uint32_t caplen, SlabAllocator *allocator = nullptr);
   ~Packet();
   Packet(const Packet &) = delete;
   Packet &operator=(const Packet &) = delete;
@@ -28,6 +36,13 @@ public:
   uint32_t ts_nsec() const;
   uint32_t length() const;
   bool vpacket() const;
+  bool dissected() const;
+  void setDissected(bool dissected);
+  // Bits from LayerIdTable for every layer id in the packet, or 0 if
+  // unknown.
+  uint64_t layerMask() const;
+  void setLayerMask(uint64_t mask);
+  std::mutex &mutex() const;
   std::string summary() const;
 
   std::string name() const;
@@ -40,11 +55,18 @@ public:
   v8::Local<v8::Object> payloadBuffer() const;
 
   void addLayer(const std::shared_ptr<Layer> &layer);
-  const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers() const;
+  const LayerMap &layers() const;
+  // Arena for the layers and items of this packet; see LayerArena.
+  LayerArena *arena();
+  // Bytes held in memory by the payload and the layer arena.
+  size_t memoryUsage() const;
   v8::Local<v8::Object> layersObject() const;
 
   std::unique_ptr<Packet> shallowClone();
 
+  void serialize(std::ostream &os) const;
+  static std::shared_ptr<Packet> deserialize(std::istream &is);
+
 private:
   Packet();
 
@@ -0,0 +1,67 @@
+#ifndef PACKET_BATCHER_HPP
+#define PACKET_BATCHER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// PacketBatcher collects frames on a capture thread and hands them on in
+// batches, so that the consumer takes its locks and wakes its workers once
+// per batch. A batch is flushed when it holds |size| frames or when its
+// first frame has waited |interval|, whichever comes first. poll() must be
+// called between reads for the second bound to apply.
+template <class T> class PacketBatcher {
+public:
+  typedef std::function<void(std::vector<T>)> Callback;
+
+  explicit PacketBatcher(
+      const Callback &cb, size_t size = 1024,
+      std::chrono::milliseconds interval = std::chrono::milliseconds(16))
+      : cb(cb), size(size), interval(interval) {}
+  PacketBatcher(const PacketBatcher &) = delete;
+  PacketBatcher &operator=(const PacketBatcher &) = delete;
+
+  void push(T value) {
+    if (batch.empty())
+      start = std::chrono::steady_clock::now();
+    batch.push_back(std::move(value));
+    if (batch.size() >= size)
+      flush();
+  }
+
+  void poll() {
+    if (!batch.empty() && std::chrono::steady_clock::now() - start >= interval)
+      flush();
+  }
+
+  void flush() {
+    if (batch.empty())
+      return;
+    std::vector<T> packets;
+    packets.swap(batch);
+    cb(std::move(packets));
+  }
+
+private:
+  Callback cb;
+  size_t size;
+  std::chrono::milliseconds interval;
+  std::vector<T> batch;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Hands |packets| to a Pcap::Context, in one call if it takes batches.
+template <class Context, class T>
+void deliverPackets(const Context &ctx, std::vector<T> packets) {
+  if (ctx.packetsCb) {
+    ctx.packetsCb(std::move(packets));
+  } else if (ctx.packetCb) {
+    for (auto &pkt : packets) {
+      ctx.packetCb(std::move(pkt));
+    }
+  }
+}
+
+#endif
@@ -2,62 +2,194 @@
 #include "stream_chunk.hpp"
 #include "dissector_thread.hpp"
 #include "packet.hpp"
+#include "log_message.hpp"
+#include "namespace_table.hpp"
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 
+namespace {
+const std::chrono::seconds dropReportInterval(1);
+}
+
 class PacketDispatcher::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
+  ~Private();
+  void wake(bool all);
+  bool admit();
 
 public:
   std::shared_ptr<DissectorSharedContext> dissCtx;
   std::vector<std::unique_ptr<DissectorThread>> dissectorThreads;
-  uint32_t packetSeq = 0;
+  std::atomic<uint32_t> packetSeq{0};
+  bool lazy = false;
+
+  size_t queueLimit;
+  QueuePolicy queuePolicy;
+  std::atomic<uint64_t> dropped{0};
+  std::mutex reportMutex;
+  uint64_t reported = 0;
+  std::chrono::steady_clock::time_point lastReport;
 };
 
 PacketDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
-    : dissCtx(std::make_shared<DissectorSharedContext>()) {
+    : dissCtx(std::make_shared<DissectorSharedContext>()), lazy(ctx->lazy),
+      queueLimit(ctx->queueLimit), queuePolicy(ctx->queuePolicy) {
 
   dissCtx->config = ctx->config;
   dissCtx->dissectors = ctx->dissectors;
+  dissCtx->namespaces = std::make_shared<NamespaceTable>(
+      NamespaceTable::load(ctx->dissectors, ctx->logCb));
+  dissCtx->layerIds = ctx->layerIds;
   dissCtx->packetCb = ctx->packetCb;
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
+  dissCtx->queue.reset(new WorkQueue<std::unique_ptr<Packet>>());
   for (int i = 0; i < ctx->threads; ++i) {
     dissectorThreads.emplace_back(new DissectorThread(dissCtx));
   }
 }
 
+PacketDispatcher::Private::~Private() {
+  {
+    std::lock_guard<std::mutex> lock(dissCtx->mutex);
+    dissCtx->closing = true;
+  }
+  dissCtx->spaceCond.notify_all();
+}
+
+bool PacketDispatcher::Private::admit() {
+  if (queueLimit == 0 || dissCtx->queue->size() < queueLimit)
+    return true;
+
+  if (queuePolicy == POLICY_BLOCK) {
+    // Part of a batch may already be queued without a wakeup.
+    wake(true);
+    std::unique_lock<std::mutex> lock(dissCtx->mutex);
+    ++dissCtx->blocked;
+    dissCtx->spaceCond.wait(lock, [this] {
+      return dissCtx->queue->size() < queueLimit || dissCtx->closing;
+    });
+    --dissCtx->blocked;
+    return !dissCtx->closing;
+  }
+
+  // Dropped packets never get a seq, so the store stays contiguous.
+  uint64_t count = ++dropped;
+  if (queuePolicy == POLICY_DROP_COUNT && dissCtx->logCb) {
+    std::unique_lock<std::mutex> lock(reportMutex, std::try_to_lock);
+    auto now = std::chrono::steady_clock::now();
+    if (lock && now - lastReport >= dropReportInterval) {
+      LogMessage msg;
+      msg.level = LogMessage::LEVEL_WARN;
+      msg.message = "Ingest queue full: dropped " +
+                    std::to_string(count - reported) + " packets (" +
+                    std::to_string(count) + " total)";
+      msg.domain = "session";
+      dissCtx->logCb(msg);
+      reported = count;
+      lastReport = now;
+    }
+  }
+  return false;
+}
+
+void PacketDispatcher::Private::wake(bool all) {
+  // Workers only sleep after registering themselves and finding the queue
+  // empty under the mutex, so the lock is needed only if one is asleep.
+  if (dissCtx->sleepers.load() == 0)
+    return;
+  std::lock_guard<std::mutex> lock(dissCtx->mutex);
+  if (all) {
+    dissCtx->cond.notify_all();
+  } else {
+    dissCtx->cond.notify_one();
+  }
+}
+
 PacketDispatcher::PacketDispatcher(const std::shared_ptr<Context> &ctx)
     : d(std::make_shared<Private>(ctx)) {}
 
 PacketDispatcher::~PacketDispatcher() {}
 
-void PacketDispatcher::analyze(std::unique_ptr<Packet> packet) {
-  {
-    std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-    if (packet->seq() == 0) {
-      packet->setSeq(++d->packetSeq);
-    }
-    d->dissCtx->queue.push(std::move(packet));
+void PacketDispatcher::analyze(std::unique_ptr<Packet> packet, bool capture) {
+  if (d->lazy) {
+    std::vector<std::unique_ptr<Packet>> packets;
+    packets.push_back(std::move(packet));
+    analyze(std::move(packets), capture);
+    return;
   }
-  d->dissCtx->cond.notify_all();
+  if (capture && !d->admit())
+    return;
+  if (packet->seq() == 0) {
+    packet->setSeq(++d->packetSeq);
+  }
+  d->dissCtx->queue->push(std::move(packet));
+  d->wake(false);
 }
 
-void PacketDispatcher::analyze(std::vector<std::unique_ptr<Packet>> packets) {
-  {
-    std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
+void PacketDispatcher::analyze(std::vector<std::unique_ptr<Packet>> packets,
+                               bool capture) {
+  // In lazy mode frames go straight to the store undissected; dissect()
+  // runs the dissectors once a reader actually touches them.
+  if (d->lazy) {
+    std::vector<std::shared_ptr<Packet>> raw;
+    raw.reserve(packets.size());
     for (auto &pkt : packets) {
       if (pkt->seq() == 0) {
         pkt->setSeq(++d->packetSeq);
       }
-      d->dissCtx->queue.push(std::move(pkt));
+      raw.emplace_back(std::move(pkt));
     }
+    if (d->dissCtx->packetCb)
+      d->dissCtx->packetCb(raw);
+    return;
   }
-  d->dissCtx->cond.notify_all();
+  for (auto &pkt : packets) {
+    if (capture && !d->admit()) {
+      if (d->queuePolicy == POLICY_BLOCK)
+        break;
+      continue;
+    }
+    if (pkt->seq() == 0) {
+      pkt->setSeq(++d->packetSeq);
+    }
+    d->dissCtx->queue->push(std::move(pkt));
+  }
+  d->wake(true);
 }
 
 uint32_t PacketDispatcher::queueSize() const {
-  std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-  return d->dissCtx->queue.size();
+  return d->dissCtx->queue->size();
+}
+
+uint64_t PacketDispatcher::droppedPackets() const { return d->dropped; }
+
+std::vector<std::shared_ptr<Packet>>
+PacketDispatcher::dissect(const std::vector<std::shared_ptr<Packet>> &packets,
+                          bool urgent) {
+  std::vector<std::shared_ptr<Packet>> pending;
+  for (const auto &pkt : packets) {
+    if (pkt && !pkt->dissected())
+      pending.push_back(pkt);
+  }
+  if (pending.empty())
+    return pending;
+
+  std::unique_lock<std::mutex> lock(d->dissCtx->mutex);
+  // Urgent requests come from the UI thread and jump ahead of the large
+  // batches filter threads demand.
+  auto pos = urgent ? d->dissCtx->demand.begin() : d->dissCtx->demand.end();
+  d->dissCtx->demand.insert(pos, pending.begin(), pending.end());
+  d->dissCtx->demandSize = d->dissCtx->demand.size();
+  d->dissCtx->cond.notify_all();
+  d->dissCtx->dissectedCond.wait(lock, [&pending] {
+    for (const auto &pkt : pending) {
+      if (!pkt->dissected())
+        return false;
+    }
+    return true;
+  });
+  return pending;
 }
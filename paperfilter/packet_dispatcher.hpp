@@ -2,36 +2,59 @@
 #define PACKET_DISPATCHER_HPP
 
 #include "dissector.hpp"
+#include "work_queue.hpp"
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 
 class StreamChunk;
 class Layer;
 class Packet;
+class LayerIdTable;
+class NamespaceTable;
 struct LogMessage;
 
 struct DissectorSharedContext {
   std::string config;
   std::vector<Dissector> dissectors;
+  std::shared_ptr<const NamespaceTable> namespaces;
+  std::shared_ptr<LayerIdTable> layerIds;
   std::function<void(const std::vector<std::shared_ptr<Packet>> &)> packetCb;
   std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
       streamsCb;
   std::function<void(const LogMessage &)> logCb;
-  std::queue<std::unique_ptr<Packet>> queue;
+  std::unique_ptr<WorkQueue<std::unique_ptr<Packet>>> queue;
+
+  // Guards |demand| and the sleeping workers; the queue has its own lock.
   std::mutex mutex;
+  std::deque<std::shared_ptr<Packet>> demand;
+  std::atomic<size_t> demandSize{0};
+  std::atomic<int> sleepers{0};
   std::condition_variable cond;
+  std::condition_variable dissectedCond;
+
+  // Producers blocked on a full queue wait on |spaceCond|.
+  std::atomic<int> blocked{0};
+  std::atomic<bool> closing{false};
+  std::condition_variable spaceCond;
 };
 
 class PacketDispatcher {
 public:
+  enum QueuePolicy { POLICY_BLOCK, POLICY_DROP_NEWEST, POLICY_DROP_COUNT };
+
   struct Context {
     int threads;
+    bool lazy = false;
+    size_t queueLimit = 0;
+    QueuePolicy queuePolicy = POLICY_BLOCK;
     std::string config;
     std::vector<Dissector> dissectors;
+    std::shared_ptr<LayerIdTable> layerIds;
     std::function<void(const std::vector<std::shared_ptr<Packet>> &)> packetCb;
     std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
         streamsCb;
@@ -43,9 +66,16 @@ public:
   ~PacketDispatcher();
   PacketDispatcher(const PacketDispatcher &) = delete;
   PacketDispatcher &operator=(const PacketDispatcher &) = delete;
-  void analyze(std::unique_ptr<Packet> packet);
-  void analyze(std::vector<std::unique_ptr<Packet>> packets);
+  // Only packets from the live capture (|capture|) are subject to the
+  // queue limit; replayed, imported and reassembled packets always enter.
+  void analyze(std::unique_ptr<Packet> packet, bool capture = false);
+  void analyze(std::vector<std::unique_ptr<Packet>> packets,
+               bool capture = false);
+  std::vector<std::shared_ptr<Packet>>
+  dissect(const std::vector<std::shared_ptr<Packet>> &packets,
+          bool urgent = false);
   uint32_t queueSize() const;
+  uint64_t droppedPackets() const;
 
 private:
   class Private;
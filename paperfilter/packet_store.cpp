@@ -1,91 +1,455 @@
 #include "packet_store.hpp"
+#include "large_buffer.hpp"
+#include "log_message.hpp"
 #include "packet.hpp"
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
 #include <unordered_map>
-#include <uv.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+const uint32_t segmentBits = 12;
+const uint32_t segmentSize = 1 << segmentBits;
+const uint32_t segmentMask = segmentSize - 1;
+
+typedef std::array<std::shared_ptr<Packet>, segmentSize> Segment;
+
+struct Directory {
+  explicit Directory(size_t capacity)
+      : capacity(capacity), segments(new std::atomic<Segment *>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+      segments[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+  size_t capacity;
+  std::unique_ptr<std::atomic<Segment *>[]> segments;
+};
+
+struct SpillEntry {
+  uint64_t offset = 0;
+  uint32_t size = 0;
+  bool dissected = false;
+};
+
+#ifdef _WIN32
+// The CRT has no positional I/O, so seek and transfer under one lock.
+std::mutex seekMutex;
+
+int openFile(const std::string &path) {
+  return _open(path.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+}
+
+void closeFile(int fd) { _close(fd); }
+
+bool readAt(int fd, char *data, size_t size, uint64_t offset) {
+  std::lock_guard<std::mutex> lock(seekMutex);
+  if (_lseeki64(fd, offset, SEEK_SET) < 0)
+    return false;
+  return _read(fd, data, size) == static_cast<int>(size);
+}
+
+bool writeAt(int fd, const char *data, size_t size, uint64_t offset) {
+  std::lock_guard<std::mutex> lock(seekMutex);
+  if (_lseeki64(fd, offset, SEEK_SET) < 0)
+    return false;
+  return _write(fd, data, size) == static_cast<int>(size);
+}
+#else
+int openFile(const std::string &path) {
+  return open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+}
+
+void closeFile(int fd) { close(fd); }
+
+bool readAt(int fd, char *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t n = pread(fd, data, size, offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+bool writeAt(int fd, const char *data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t n = pwrite(fd, data, size, offset);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+#endif
+}
 
 class PacketStore::Private {
 public:
-  Private();
+  Private(size_t memoryBudget,
+          const std::function<void(const LogMessage &)> &logCb);
   ~Private();
+  bool filled(uint32_t seq) const;
+  Segment &segment(uint32_t seq) const;
+  std::shared_ptr<Packet> load(uint32_t seq);
+  std::shared_ptr<Packet> fault(uint32_t seq);
+  void charge(uint32_t seq, size_t usage);
+  void log(const std::string &message) const;
+  void writer();
+  bool spill(const std::vector<uint32_t> &victims);
 
 public:
-  uv_rwlock_t rwlock;
+  std::mutex mutex;
   std::unordered_map<int, std::function<void(uint32_t)>> handlers;
-  uint32_t maxSeq = 0;
-  std::map<uint32_t, std::shared_ptr<Packet>> packets;
+  std::atomic<uint32_t> maxSeq;
+  std::atomic<Directory *> directory;
+  std::vector<std::unique_ptr<Segment>> segments;
+  std::vector<std::unique_ptr<Directory>> directories;
+  std::function<void(const LogMessage &)> logCb;
+
+  // Slots only change after publication when packets can be evicted.
+  const bool evictable;
+  size_t memoryBudget;
+  size_t residentBytes = 0;
+  std::deque<uint32_t> resident;
+  std::unordered_map<uint32_t, size_t> residentUsage;
+
+  // Eviction runs on |writerThread| so that insert() never waits on disk.
+  std::thread writerThread;
+  std::condition_variable writerCond;
+  bool evictPending = false;
+  bool closing = false;
+
+  // |spillMutex| guards |spillEntries|; the file is read with positional
+  // reads, so faults do not serialize on a shared stream position.
+  mutable std::mutex spillMutex;
+  int spillFd = -1;
+  std::string spillPath;
+  uint64_t spillSize = 0;
+  std::vector<SpillEntry> spillEntries;
 };
 
-PacketStore::Private::Private() { uv_rwlock_init(&rwlock); }
+PacketStore::Private::Private(
+    size_t memoryBudget, const std::function<void(const LogMessage &)> &logCb)
+    : maxSeq(0), directory(nullptr), logCb(logCb),
+      evictable(memoryBudget > 0), memoryBudget(memoryBudget) {
+  directories.emplace_back(new Directory(16));
+  directory.store(directories.back().get());
+  if (evictable) {
+    writerThread = std::thread([this] { writer(); });
+  }
+}
 
-PacketStore::Private::~Private() { uv_rwlock_destroy(&rwlock); }
+PacketStore::Private::~Private() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closing = true;
+  }
+  writerCond.notify_all();
+  if (writerThread.joinable())
+    writerThread.join();
+  if (spillFd >= 0) {
+    closeFile(spillFd);
+    std::remove(spillPath.c_str());
+  }
+}
 
-PacketStore::PacketStore() : d(new Private()) {}
+bool PacketStore::Private::filled(uint32_t seq) const {
+  uint32_t index = seq >> segmentBits;
+  return index < segments.size() && (*segments[index])[seq & segmentMask];
+}
+
+Segment &PacketStore::Private::segment(uint32_t seq) const {
+  const Directory *dir = directory.load(std::memory_order_acquire);
+  return *dir->segments[seq >> segmentBits].load(std::memory_order_acquire);
+}
+
+std::shared_ptr<Packet> PacketStore::Private::load(uint32_t seq) {
+  const auto &slot = segment(seq)[seq & segmentMask];
+
+  // A slot is written once before maxSeq covers it and, without a memory
+  // budget, never again, so plain reads are safe. The atomic shared_ptr
+  // functions take a global spinlock and are only paid for when eviction
+  // can swap the slot under a reader.
+  if (!evictable)
+    return slot;
+  if (std::shared_ptr<Packet> pkt = std::atomic_load(&slot))
+    return pkt;
+  return fault(seq);
+}
+
+std::shared_ptr<Packet> PacketStore::Private::fault(uint32_t seq) {
+  SpillEntry entry;
+  {
+    std::lock_guard<std::mutex> lock(spillMutex);
+    if (seq >= spillEntries.size() || spillEntries[seq].size == 0)
+      return std::shared_ptr<Packet>();
+    entry = spillEntries[seq];
+  }
+  std::string data(entry.size, '\0');
+  if (!readAt(spillFd, &data[0], data.size(), entry.offset)) {
+    log("Failed to read packet #" + std::to_string(seq) + " from " +
+        spillPath + ": " + std::strerror(errno));
+    return std::shared_ptr<Packet>();
+  }
+  std::istringstream is(data);
+  std::shared_ptr<Packet> pkt = Packet::deserialize(is);
+  if (!pkt)
+    return pkt;
+
+  // Put the packet back in its slot so that it is read, and dissected in
+  // lazy mode, only once until the writer evicts it again.
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &slot = segment(seq)[seq & segmentMask];
+  if (std::shared_ptr<Packet> current = std::atomic_load(&slot))
+    return current;
+  std::atomic_store(&slot, pkt);
+  resident.push_back(seq);
+  charge(seq, pkt->memoryUsage());
+  return pkt;
+}
+
+void PacketStore::Private::charge(uint32_t seq, size_t usage) {
+  size_t &charged = residentUsage[seq];
+  residentBytes = residentBytes - charged + usage;
+  charged = usage;
+  if (memoryBudget > 0 && residentBytes > memoryBudget) {
+    evictPending = true;
+    writerCond.notify_one();
+  }
+}
+
+void PacketStore::Private::log(const std::string &message) const {
+  if (logCb) {
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_ERROR;
+    msg.message = message;
+    msg.domain = "session";
+    logCb(msg);
+  }
+}
+
+void PacketStore::Private::writer() {
+  std::vector<uint32_t> victims;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      writerCond.wait(lock, [this] { return evictPending || closing; });
+      if (closing)
+        return;
+      evictPending = false;
+
+      // Evict the oldest resident packets. Only seqs up to maxSeq are
+      // evicted so that an empty slot below maxSeq always means the packet
+      // is on disk.
+      uint32_t published = maxSeq.load(std::memory_order_relaxed);
+      while (residentBytes > memoryBudget && !resident.empty() &&
+             resident.front() <= published) {
+        uint32_t seq = resident.front();
+        resident.pop_front();
+        auto it = residentUsage.find(seq);
+        residentBytes -= it->second;
+        residentUsage.erase(it);
+        victims.push_back(seq);
+      }
+    }
+
+    if (!victims.empty() && !spill(victims)) {
+      // Keep everything in memory from now on rather than failing again
+      // for every batch.
+      log("Spilling packets to disk is disabled");
+      std::lock_guard<std::mutex> lock(mutex);
+      memoryBudget = 0;
+    }
+    victims.clear();
+  }
+}
+
+bool PacketStore::Private::spill(const std::vector<uint32_t> &victims) {
+  if (spillFd < 0) {
+    static std::atomic<int> count(0);
+    spillPath =
+        LargeBuffer::tmpDir() + "/packets_" + std::to_string(++count) + ".bin";
+    spillFd = openFile(spillPath);
+    if (spillFd < 0) {
+      log("Failed to open " + spillPath + ": " + std::strerror(errno));
+      return false;
+    }
+  }
+
+  for (uint32_t seq : victims) {
+    auto &slot = segment(seq)[seq & segmentMask];
+    std::shared_ptr<Packet> pkt = std::atomic_load(&slot);
+    if (!pkt)
+      continue;
+
+    // A faulted packet that has not been dissected since is already on
+    // disk in its current form.
+    {
+      std::lock_guard<std::mutex> lock(spillMutex);
+      if (seq < spillEntries.size() && spillEntries[seq].size > 0 &&
+          spillEntries[seq].dissected == pkt->dissected()) {
+        std::atomic_store(&slot, std::shared_ptr<Packet>());
+        continue;
+      }
+    }
+
+    std::ostringstream os;
+    pkt->serialize(os);
+    const std::string &data = os.str();
+    if (!writeAt(spillFd, data.data(), data.size(), spillSize)) {
+      log("Failed to write " + spillPath + ": " + std::strerror(errno));
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(spillMutex);
+      if (spillEntries.size() <= seq)
+        spillEntries.resize(seq + 1);
+      spillEntries[seq].offset = spillSize;
+      spillEntries[seq].size = data.size();
+      spillEntries[seq].dissected = pkt->dissected();
+    }
+    spillSize += data.size();
+    std::atomic_store(&slot, std::shared_ptr<Packet>());
+  }
+  return true;
+}
+
+PacketStore::PacketStore(
+    size_t memoryBudget, const std::function<void(const LogMessage &)> &logCb)
+    : d(new Private(memoryBudget, logCb)) {}
 
 PacketStore::~PacketStore() {}
 
 void PacketStore::insert(const std::vector<std::shared_ptr<Packet>> &packets) {
-  uint32_t oldMaxSeq = d->maxSeq;
-  uint32_t maxSeq = oldMaxSeq;
-  uv_rwlock_wrlock(&d->rwlock);
+  std::lock_guard<std::mutex> lock(d->mutex);
+  uint32_t oldMaxSeq = d->maxSeq.load(std::memory_order_relaxed);
+
+  uint32_t lastSeq = 0;
   for (const auto &pkt : packets) {
-    d->packets[pkt->seq()] = pkt;
-    uint32_t seq = d->maxSeq;
-    for (auto it = d->packets.find(seq + 1); it != d->packets.end();
-         seq++, it = d->packets.find(seq + 1))
-      ;
-    if (d->maxSeq < seq) {
-      d->maxSeq = seq;
-      maxSeq = seq;
+    lastSeq = std::max(lastSeq, pkt->seq());
+  }
+
+  // Readers never lock. A grown directory is published with a single
+  // pointer swap, and the replaced ones are retired until the store is
+  // destroyed, which serves as the grace period for in-flight readers.
+  size_t required = (lastSeq >> segmentBits) + 1;
+  while (d->segments.size() < required) {
+    Directory *dir = d->directory.load(std::memory_order_relaxed);
+    if (d->segments.size() >= dir->capacity) {
+      Directory *next = new Directory(dir->capacity * 2);
+      for (size_t i = 0; i < d->segments.size(); ++i) {
+        next->segments[i].store(d->segments[i].get(),
+                                std::memory_order_relaxed);
+      }
+      d->directories.emplace_back(next);
+      d->directory.store(next, std::memory_order_release);
+      dir = next;
     }
+    d->segments.emplace_back(new Segment());
+    dir->segments[d->segments.size() - 1].store(d->segments.back().get(),
+                                                std::memory_order_release);
+  }
+
+  // Slots above maxSeq are invisible to readers, so they can be filled
+  // in place before maxSeq is published.
+  for (const auto &pkt : packets) {
+    uint32_t seq = pkt->seq();
+    (*d->segments[seq >> segmentBits])[seq & segmentMask] = pkt;
+    if (d->memoryBudget > 0) {
+      d->resident.push_back(seq);
+      d->residentUsage[seq] = pkt->memoryUsage();
+      d->residentBytes += d->residentUsage[seq];
+    }
+  }
+
+  uint32_t maxSeq = oldMaxSeq;
+  while (d->filled(maxSeq + 1)) {
+    ++maxSeq;
   }
-  uv_rwlock_wrunlock(&d->rwlock);
+
   if (oldMaxSeq < maxSeq) {
+    d->maxSeq.store(maxSeq, std::memory_order_release);
     for (const auto &pair : d->handlers) {
       if (pair.second)
         pair.second(maxSeq);
     }
   }
+
+  if (d->memoryBudget > 0 && d->residentBytes > d->memoryBudget) {
+    d->evictPending = true;
+    d->writerCond.notify_one();
+  }
 }
 
 std::vector<std::shared_ptr<Packet>> PacketStore::get(uint32_t start,
                                                       uint32_t end) const {
   std::vector<std::shared_ptr<Packet>> packets;
-  if (start > end)
+  end = std::min(end, d->maxSeq.load(std::memory_order_acquire));
+  if (start == 0 || start > end)
     return packets;
-  uv_rwlock_rdlock(&d->rwlock);
-  for (auto it = d->packets.find(start); it != d->packets.end(); ++it) {
-    packets.push_back(it->second);
-    if (it->second->seq() >= end)
-      break;
+  packets.reserve(end - start + 1);
+  for (uint32_t seq = start; seq <= end; ++seq) {
+    packets.push_back(d->load(seq));
   }
-  uv_rwlock_rdunlock(&d->rwlock);
   return packets;
 }
 
 std::shared_ptr<Packet> PacketStore::get(uint32_t seq) const {
-  std::shared_ptr<Packet> pkt;
-  uv_rwlock_rdlock(&d->rwlock);
-  auto it = d->packets.find(seq);
-  if (it != d->packets.end())
-    pkt = it->second;
-  uv_rwlock_rdunlock(&d->rwlock);
-  return pkt;
+  if (seq == 0 || seq > d->maxSeq.load(std::memory_order_acquire))
+    return std::shared_ptr<Packet>();
+  return d->load(seq);
 }
 
-uint32_t PacketStore::maxSeq() const { return d->maxSeq; }
+void PacketStore::updateUsage(
+    const std::vector<std::shared_ptr<Packet>> &packets) {
+  if (!d->evictable || packets.empty())
+    return;
+  std::lock_guard<std::mutex> lock(d->mutex);
+  for (const auto &pkt : packets) {
+    // Packets evicted in the meantime are no longer charged.
+    if (d->residentUsage.count(pkt->seq()))
+      d->charge(pkt->seq(), pkt->memoryUsage());
+  }
+}
+
+uint32_t PacketStore::maxSeq() const {
+  return d->maxSeq.load(std::memory_order_acquire);
+}
 
 int PacketStore::addHandler(const std::function<void(uint32_t)> &cb) {
   static int handlerId = 0;
+  std::lock_guard<std::mutex> lock(d->mutex);
   int id = ++handlerId;
-  uv_rwlock_wrlock(&d->rwlock);
   d->handlers[id] = cb;
-  uv_rwlock_wrunlock(&d->rwlock);
   return id;
 }
 
 void PacketStore::removeHandler(int id) {
-  uv_rwlock_wrlock(&d->rwlock);
+  std::lock_guard<std::mutex> lock(d->mutex);
   d->handlers.erase(id);
-  uv_rwlock_wrunlock(&d->rwlock);
 }
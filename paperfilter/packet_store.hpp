@@ -1,21 +1,26 @@
 #ifndef PACKET_STORE_HPP
 #define PACKET_STORE_HPP
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <vector>
 
 class Packet;
+struct LogMessage;
 
 class PacketStore {
 public:
-  PacketStore();
+  explicit PacketStore(
+      size_t memoryBudget = 0,
+      const std::function<void(const LogMessage &)> &logCb = nullptr);
   ~PacketStore();
   PacketStore(const PacketStore &) = delete;
   PacketStore &operator=(const PacketStore &) = delete;
   void insert(const std::vector<std::shared_ptr<Packet>> &packets);
   std::vector<std::shared_ptr<Packet>> get(uint32_t start, uint32_t end) const;
   std::shared_ptr<Packet> get(uint32_t seq) const;
+  void updateUsage(const std::vector<std::shared_ptr<Packet>> &packets);
   uint32_t maxSeq() const;
   int addHandler(const std::function<void(uint32_t)> &cb);
   void removeHandler(int id);
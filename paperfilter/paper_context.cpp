@@ -7,12 +7,19 @@
 #include "packet.hpp"
 #include "console.hpp"
 #include "stream_chunk.hpp"
+#include <mutex>
+#include <unordered_map>
 #include <v8pp/class.hpp>
 #include <v8pp/module.hpp>
 
 using namespace v8;
 
 namespace {
+// v8pp class templates can only be created once per isolate, so pooled
+// isolates keep the module template built by their first init().
+std::mutex templateMutex;
+std::unordered_map<Isolate *, Persistent<ObjectTemplate> *> moduleTemplates;
+
 void initModule(v8pp::module *module, v8::Isolate *isolate) {
   v8pp::class_<Console> Console_class(isolate);
   Console_class.set("log", &Console::log);
@@ -40,12 +47,27 @@ void initModule(v8pp::module *module, v8::Isolate *isolate) {
   Buffer_class.set("indexOf", &Buffer::indexOf);
   Buffer_class.set("readInt8", &Buffer::readInt8);
   Buffer_class.set("readInt16BE", &Buffer::readInt16BE);
+  Buffer_class.set("readInt16LE", &Buffer::readInt16LE);
   Buffer_class.set("readInt32BE", &Buffer::readInt32BE);
+  Buffer_class.set("readInt32LE", &Buffer::readInt32LE);
   Buffer_class.set("readUInt8", &Buffer::readUInt8);
   Buffer_class.set("readUInt16BE", &Buffer::readUInt16BE);
+  Buffer_class.set("readUInt16LE", &Buffer::readUInt16LE);
   Buffer_class.set("readUInt32BE", &Buffer::readUInt32BE);
+  Buffer_class.set("readUInt32LE", &Buffer::readUInt32LE);
+  Buffer_class.set("readBigInt64BE", &Buffer::readBigInt64BE);
+  Buffer_class.set("readBigInt64LE", &Buffer::readBigInt64LE);
+  Buffer_class.set("readBigUInt64BE", &Buffer::readBigUInt64BE);
+  Buffer_class.set("readBigUInt64LE", &Buffer::readBigUInt64LE);
   Buffer_class.set("readDoubleBE", &Buffer::readDoubleBE);
+  Buffer_class.set("readDoubleLE", &Buffer::readDoubleLE);
   Buffer_class.set("readFloatBE", &Buffer::readFloatBE);
+  Buffer_class.set("readFloatLE", &Buffer::readFloatLE);
+  Buffer_class.set("readBits", &Buffer::readBits);
+  Buffer_class.set("readUInt16Array", &Buffer::readUInt16Array);
+  Buffer_class.set("readUInt32Array", &Buffer::readUInt32Array);
+  Buffer_class.set("bytes", v8pp::property(&Buffer::bytes));
+  Buffer_class.set("dataView", v8pp::property(&Buffer::dataView));
 
   Buffer_class.class_function_template()
       ->PrototypeTemplate()
@@ -124,11 +146,22 @@ void initModule(v8pp::module *module, v8::Isolate *isolate) {
   module->set("StreamChunk", StreamChunk_class);
   module->set("LargeBuffer", LargeBuffer_class);
 }
+
+Local<ObjectTemplate> moduleTemplate(Isolate *isolate) {
+  std::lock_guard<std::mutex> lock(templateMutex);
+  auto it = moduleTemplates.find(isolate);
+  if (it != moduleTemplates.end())
+    return Local<ObjectTemplate>::New(isolate, *it->second);
+
+  Local<ObjectTemplate> tmpl = ObjectTemplate::New(isolate);
+  v8pp::module dripcap(isolate, tmpl);
+  initModule(&dripcap, isolate);
+  moduleTemplates[isolate] = new Persistent<ObjectTemplate>(isolate, tmpl);
+  return tmpl;
+}
 }
 
 void PaperContext::init(v8::Isolate *isolate) {
-  v8pp::module dripcap(isolate);
-  initModule(&dripcap, isolate);
   Local<FunctionTemplate> require = FunctionTemplate::New(
       isolate, [](FunctionCallbackInfo<Value> const &args) {
         Isolate *isolate = Isolate::GetCurrent();
@@ -141,7 +174,7 @@ void PaperContext::init(v8::Isolate *isolate) {
           args.GetReturnValue().Set(
               v8pp::throw_ex(isolate, (err + name + "'").c_str()));
         }
-      }, dripcap.new_instance());
+      }, moduleTemplate(isolate)->NewInstance());
 
   isolate->GetCurrentContext()->Global()->Set(v8pp::to_v8(isolate, "require"),
                                               require->GetFunction());
@@ -153,3 +186,13 @@ void PaperContext::init(v8::Local<v8::Object> module) {
   initModule(&dripcap, isolate);
   module->Set(v8pp::to_v8(isolate, "exports"), dripcap.new_instance());
 }
+
+void PaperContext::dispose(v8::Isolate *isolate) {
+  std::lock_guard<std::mutex> lock(templateMutex);
+  auto it = moduleTemplates.find(isolate);
+  if (it != moduleTemplates.end()) {
+    it->second->Reset();
+    delete it->second;
+    moduleTemplates.erase(it);
+  }
+}
@@ -0,0 +1,349 @@
+#include "roaring_bitmap.hpp"
+#include <algorithm>
+#include <iterator>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+const size_t arrayLimit = 4096;
+const size_t bitmapWords = 1024;
+
+int popcount(uint64_t word) {
+#ifdef _MSC_VER
+  return static_cast<int>(__popcnt64(word));
+#else
+  return __builtin_popcountll(word);
+#endif
+}
+
+int countTrailingZeros(uint64_t word) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward64(&index, word);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+uint64_t lowMask(uint32_t bits) {
+  return bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+}
+}
+
+RoaringBitmap::RoaringBitmap() {}
+
+RoaringBitmap::~RoaringBitmap() {}
+
+std::vector<RoaringBitmap::Container>::const_iterator
+RoaringBitmap::find(uint16_t key) const {
+  return std::lower_bound(
+      containers.begin(), containers.end(), key,
+      [](const Container &container, uint16_t key) {
+        return container.key < key;
+      });
+}
+
+void RoaringBitmap::add(uint32_t value) {
+  uint16_t key = value >> 16;
+  uint16_t low = value & 0xffff;
+
+  auto it = containers.begin() + (find(key) - containers.cbegin());
+  if (it == containers.end() || it->key != key) {
+    it = containers.emplace(it);
+    it->key = key;
+  }
+
+  Container &container = *it;
+  if (container.bitmap.empty()) {
+    std::vector<uint16_t> &array = container.array;
+    auto pos = (array.empty() || array.back() < low)
+                   ? array.end()
+                   : std::lower_bound(array.begin(), array.end(), low);
+    if (pos != array.end() && *pos == low)
+      return;
+    array.insert(pos, low);
+    ++container.cardinality;
+    if (array.size() > arrayLimit)
+      assign(&container, words(container));
+  } else {
+    uint64_t &word = container.bitmap[low >> 6];
+    uint64_t bit = uint64_t(1) << (low & 63);
+    if (!(word & bit)) {
+      word |= bit;
+      ++container.cardinality;
+    }
+  }
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+  uint16_t key = value >> 16;
+  uint16_t low = value & 0xffff;
+  auto it = find(key);
+  if (it == containers.end() || it->key != key)
+    return false;
+  if (it->bitmap.empty())
+    return std::binary_search(it->array.begin(), it->array.end(), low);
+  return (it->bitmap[low >> 6] >> (low & 63)) & 1;
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+  uint64_t count = 0;
+  for (const Container &container : containers) {
+    count += container.cardinality;
+  }
+  return count;
+}
+
+uint64_t RoaringBitmap::rank(uint32_t value) const {
+  uint16_t key = value >> 16;
+  uint16_t low = value & 0xffff;
+  uint64_t rank = 0;
+  for (const Container &container : containers) {
+    if (container.key > key)
+      break;
+    if (container.key < key) {
+      rank += container.cardinality;
+      continue;
+    }
+    if (container.bitmap.empty()) {
+      const std::vector<uint16_t> &array = container.array;
+      rank += std::upper_bound(array.begin(), array.end(), low) - array.begin();
+    } else {
+      size_t index = low >> 6;
+      for (size_t i = 0; i < index; ++i) {
+        rank += popcount(container.bitmap[i]);
+      }
+      rank += popcount(container.bitmap[index] & lowMask((low & 63) + 1));
+    }
+    break;
+  }
+  return rank;
+}
+
+uint32_t RoaringBitmap::select(uint64_t index) const {
+  for (const Container &container : containers) {
+    if (index >= container.cardinality) {
+      index -= container.cardinality;
+      continue;
+    }
+    uint32_t high = static_cast<uint32_t>(container.key) << 16;
+    if (container.bitmap.empty())
+      return high | container.array[index];
+    for (size_t i = 0; i < bitmapWords; ++i) {
+      uint64_t word = container.bitmap[i];
+      uint64_t count = popcount(word);
+      if (index < count) {
+        for (; index > 0; --index) {
+          word &= word - 1;
+        }
+        return high | (i * 64 + countTrailingZeros(word));
+      }
+      index -= count;
+    }
+  }
+  return 0;
+}
+
+std::vector<uint32_t> RoaringBitmap::slice(uint64_t start,
+                                           uint64_t end) const {
+  std::vector<uint32_t> values;
+  if (start > end)
+    return values;
+
+  uint64_t index = 0;
+  for (const Container &container : containers) {
+    if (index > end)
+      break;
+    if (index + container.cardinality <= start) {
+      index += container.cardinality;
+      continue;
+    }
+
+    uint32_t high = static_cast<uint32_t>(container.key) << 16;
+    if (container.bitmap.empty()) {
+      const std::vector<uint16_t> &array = container.array;
+      size_t i = start > index ? start - index : 0;
+      for (index += i; i < array.size() && index <= end; ++i, ++index) {
+        values.push_back(high | array[i]);
+      }
+      index += array.size() - i;
+    } else {
+      for (size_t i = 0; i < bitmapWords && index <= end; ++i) {
+        uint64_t word = container.bitmap[i];
+        uint64_t count = popcount(word);
+        if (index + count <= start) {
+          index += count;
+          continue;
+        }
+        while (word && index <= end) {
+          if (index >= start)
+            values.push_back(high | (i * 64 + countTrailingZeros(word)));
+          word &= word - 1;
+          ++index;
+        }
+        index += popcount(word);
+      }
+    }
+  }
+  return values;
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap &other) const {
+  return combine(*this, other, AND);
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap &other) const {
+  return combine(*this, other, OR);
+}
+
+RoaringBitmap RoaringBitmap::andNot(const RoaringBitmap &other) const {
+  return combine(*this, other, AND_NOT);
+}
+
+RoaringBitmap RoaringBitmap::range(uint32_t first, uint32_t last) {
+  RoaringBitmap result;
+  if (first > last)
+    return result;
+
+  for (uint32_t key = first >> 16; key <= (last >> 16); ++key) {
+    uint32_t begin = (key == (first >> 16)) ? (first & 0xffff) : 0;
+    uint32_t end = (key == (last >> 16)) ? (last & 0xffff) : 0xffff;
+    std::vector<uint64_t> bitmap(bitmapWords, 0);
+    for (uint32_t i = begin >> 6; i <= (end >> 6); ++i) {
+      uint64_t mask = ~uint64_t(0);
+      if (i == (begin >> 6))
+        mask &= ~lowMask(begin & 63);
+      if (i == (end >> 6))
+        mask &= lowMask((end & 63) + 1);
+      bitmap[i] = mask;
+    }
+    result.containers.emplace_back();
+    result.containers.back().key = key;
+    assign(&result.containers.back(), bitmap);
+  }
+  return result;
+}
+
+RoaringBitmap RoaringBitmap::tail(uint32_t value) const {
+  RoaringBitmap result;
+  result.containers.assign(find(value >> 16), containers.cend());
+  return result;
+}
+
+void RoaringBitmap::replaceTail(uint32_t value, const RoaringBitmap &tail) {
+  auto first = containers.begin() + (find(value >> 16) - containers.cbegin());
+  containers.erase(first, containers.end());
+  containers.insert(containers.end(), tail.containers.begin(),
+                    tail.containers.end());
+}
+
+size_t RoaringBitmap::memoryUsage() const {
+  size_t usage = sizeof(*this) + containers.capacity() * sizeof(Container);
+  for (const Container &container : containers) {
+    usage += container.array.capacity() * sizeof(uint16_t) +
+             container.bitmap.capacity() * sizeof(uint64_t);
+  }
+  return usage;
+}
+
+RoaringBitmap RoaringBitmap::combine(const RoaringBitmap &lhs,
+                                     const RoaringBitmap &rhs, Operation op) {
+  RoaringBitmap result;
+  auto l = lhs.containers.begin();
+  auto r = rhs.containers.begin();
+  while (l != lhs.containers.end() || r != rhs.containers.end()) {
+    if (r == rhs.containers.end() ||
+        (l != lhs.containers.end() && l->key < r->key)) {
+      if (op != AND)
+        result.containers.push_back(*l);
+      ++l;
+    } else if (l == lhs.containers.end() || r->key < l->key) {
+      if (op == OR)
+        result.containers.push_back(*r);
+      ++r;
+    } else {
+      Container container;
+      container.key = l->key;
+      if (l->bitmap.empty() && r->bitmap.empty()) {
+        std::vector<uint16_t> &array = container.array;
+        auto out = std::back_inserter(array);
+        switch (op) {
+        case AND:
+          std::set_intersection(l->array.begin(), l->array.end(),
+                                r->array.begin(), r->array.end(), out);
+          break;
+        case OR:
+          std::set_union(l->array.begin(), l->array.end(), r->array.begin(),
+                         r->array.end(), out);
+          break;
+        case AND_NOT:
+          std::set_difference(l->array.begin(), l->array.end(),
+                              r->array.begin(), r->array.end(), out);
+          break;
+        }
+        container.cardinality = array.size();
+        if (array.size() > arrayLimit)
+          assign(&container, words(container));
+      } else {
+        std::vector<uint64_t> bitmap = words(*l);
+        const std::vector<uint64_t> &other = words(*r);
+        for (size_t i = 0; i < bitmapWords; ++i) {
+          switch (op) {
+          case AND:
+            bitmap[i] &= other[i];
+            break;
+          case OR:
+            bitmap[i] |= other[i];
+            break;
+          case AND_NOT:
+            bitmap[i] &= ~other[i];
+            break;
+          }
+        }
+        assign(&container, bitmap);
+      }
+      if (container.cardinality > 0)
+        result.containers.push_back(std::move(container));
+      ++l;
+      ++r;
+    }
+  }
+  return result;
+}
+
+std::vector<uint64_t> RoaringBitmap::words(const Container &container) {
+  if (!container.bitmap.empty())
+    return container.bitmap;
+  std::vector<uint64_t> bitmap(bitmapWords, 0);
+  for (uint16_t low : container.array) {
+    bitmap[low >> 6] |= uint64_t(1) << (low & 63);
+  }
+  return bitmap;
+}
+
+void RoaringBitmap::assign(Container *container,
+                           const std::vector<uint64_t> &words) {
+  uint32_t cardinality = 0;
+  for (uint64_t word : words) {
+    cardinality += popcount(word);
+  }
+  container->cardinality = cardinality;
+
+  if (cardinality > arrayLimit) {
+    container->bitmap = words;
+    std::vector<uint16_t>().swap(container->array);
+    return;
+  }
+
+  std::vector<uint64_t>().swap(container->bitmap);
+  std::vector<uint16_t> array;
+  array.reserve(cardinality);
+  for (size_t i = 0; i < words.size(); ++i) {
+    for (uint64_t word = words[i]; word; word &= word - 1) {
+      array.push_back(i * 64 + countTrailingZeros(word));
+    }
+  }
+  container->array.swap(array);
+}
@@ -0,0 +1,60 @@
+#ifndef ROARING_BITMAP_HPP
+#define ROARING_BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A compressed set of uint32_t values in the style of Roaring bitmaps.
+// Values are partitioned by their upper 16 bits; each partition is stored
+// as a sorted array while sparse and as a 65536-bit bitmap once dense.
+class RoaringBitmap {
+public:
+  RoaringBitmap();
+  ~RoaringBitmap();
+
+  void add(uint32_t value);
+  bool contains(uint32_t value) const;
+  uint64_t cardinality() const;
+
+  // Number of values less than or equal to |value|.
+  uint64_t rank(uint32_t value) const;
+  // The |index|-th smallest value, or 0 if out of range.
+  uint32_t select(uint64_t index) const;
+  // Values whose ranks are within [start, end].
+  std::vector<uint32_t> slice(uint64_t start, uint64_t end) const;
+
+  RoaringBitmap operator&(const RoaringBitmap &other) const;
+  RoaringBitmap operator|(const RoaringBitmap &other) const;
+  RoaringBitmap andNot(const RoaringBitmap &other) const;
+  static RoaringBitmap range(uint32_t first, uint32_t last);
+
+  // The values in the partitions at or above the one holding |value|.
+  RoaringBitmap tail(uint32_t value) const;
+  // Replaces the partitions at or above the one holding |value| with those
+  // of |tail|, which must not hold smaller values.
+  void replaceTail(uint32_t value, const RoaringBitmap &tail);
+
+  size_t memoryUsage() const;
+
+private:
+  struct Container {
+    uint16_t key = 0;
+    uint32_t cardinality = 0;
+    std::vector<uint16_t> array;
+    std::vector<uint64_t> bitmap;
+  };
+
+  enum Operation { AND, OR, AND_NOT };
+
+  static RoaringBitmap combine(const RoaringBitmap &lhs,
+                               const RoaringBitmap &rhs, Operation op);
+  static std::vector<uint64_t> words(const Container &container);
+  static void assign(Container *container, const std::vector<uint64_t> &words);
+  std::vector<Container>::const_iterator find(uint16_t key) const;
+
+private:
+  std::vector<Container> containers;
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include "script_cache.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <v8pp/convert.hpp>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#endif
+
+#if V8_MAJOR_VERSION > 6 || (V8_MAJOR_VERSION == 6 && V8_MINOR_VERSION >= 7)
+#define SCRIPT_CACHE_CREATE_CODE_CACHE
+#endif
+
+namespace {
+typedef std::shared_ptr<const std::string> CacheData;
+
+std::mutex cacheMutex;
+std::unordered_map<std::string, CacheData> cacheMap;
+
+std::string cacheKey(const std::string &source) {
+  // FNV-1a over the source and the V8 version, since a cache produced by
+  // another V8 build is always rejected.
+  uint64_t hash = 14695981039346656037ull;
+  auto update = [&hash](const std::string &str) {
+    for (unsigned char c : str) {
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+  };
+  update(v8::V8::GetVersion());
+  update(source);
+
+  std::stringstream stream;
+  stream << std::hex << std::setfill('0') << std::setw(16) << hash << "_"
+         << source.size();
+  return stream.str();
+}
+
+bool makePrivateDir(const std::string &path) {
+#ifdef _WIN32
+  _mkdir(path.c_str());
+  struct _stat st;
+  return _stat(path.c_str(), &st) == 0 && (st.st_mode & _S_IFDIR);
+#else
+  mkdir(path.c_str(), 0700);
+  // Refuse a directory that another user could have planted or can write
+  // to, since its contents are fed to the V8 deserializer.
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) &&
+         st.st_uid == getuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+}
+
+std::string getCacheDir() {
+  std::string path;
+#ifdef _WIN32
+  const char *base = std::getenv("LOCALAPPDATA");
+  if (!base || !*base)
+    return std::string();
+  path = base;
+#else
+  const char *base = std::getenv("XDG_CACHE_HOME");
+  if (base && *base) {
+    path = base;
+  } else {
+    const char *home = std::getenv("HOME");
+    if (!home || !*home)
+      return std::string();
+    path = std::string(home) + "/.cache";
+    mkdir(path.c_str(), 0700);
+  }
+#endif
+  path += "/paperfilter";
+  if (!makePrivateDir(path))
+    return std::string();
+  path += "/code_cache";
+  if (!makePrivateDir(path))
+    return std::string();
+  return path;
+}
+
+// Returns the per-user cache dir, or an empty string if there is none, in
+// which case the cache is kept in memory only.
+const std::string &cacheDir() {
+  static const std::string path = getCacheDir();
+  return path;
+}
+
+std::string cachePath(const std::string &key) {
+  return cacheDir() + "/" + key + ".bin";
+}
+
+void writeFile(const std::string &key, const uint8_t *data, int length) {
+  // Write to a unique temporary file and rename it into place, so that a
+  // concurrent reader in another process never sees a partial cache.
+  std::random_device dev;
+  std::stringstream suffix;
+  suffix << std::hex << dev() << dev();
+  const std::string &path = cachePath(key);
+  const std::string &tmpPath = path + "." + suffix.str() + ".tmp";
+  {
+    std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char *>(data), length);
+    if (!ofs.flush()) {
+      ofs.close();
+      std::remove(tmpPath.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    std::remove(tmpPath.c_str());
+}
+
+CacheData load(const std::string &key) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  auto it = cacheMap.find(key);
+  if (it != cacheMap.end())
+    return it->second;
+
+  if (cacheDir().empty())
+    return CacheData();
+  std::ifstream ifs(cachePath(key), std::ios::binary);
+  if (!ifs)
+    return CacheData();
+  std::stringstream stream;
+  stream << ifs.rdbuf();
+  CacheData data = std::make_shared<const std::string>(stream.str());
+  if (data->empty())
+    return CacheData();
+  cacheMap[key] = data;
+  return data;
+}
+
+void store(const std::string &key, const uint8_t *data, int length) {
+  if (!data || length <= 0)
+    return;
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cacheMap.count(key))
+    return;
+  cacheMap[key] = std::make_shared<const std::string>(
+      reinterpret_cast<const char *>(data), length);
+  if (!cacheDir().empty())
+    writeFile(key, data, length);
+}
+
+void discard(const std::string &key) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  cacheMap.erase(key);
+  if (!cacheDir().empty())
+    std::remove(cachePath(key).c_str());
+}
+}
+
+Nan::MaybeLocal<Nan::BoundScript>
+ScriptCache::compile(v8::Isolate *isolate, const std::string &source,
+                     const std::string &resourceName) {
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::String> code = v8pp::to_v8(isolate, source);
+  v8::ScriptOrigin origin(v8pp::to_v8(isolate, resourceName));
+  const std::string &key = cacheKey(source);
+
+  CacheData cached = load(key);
+  if (cached) {
+    v8::ScriptCompiler::Source cachedSource(
+        code, origin,
+        new v8::ScriptCompiler::CachedData(
+            reinterpret_cast<const uint8_t *>(cached->data()),
+            static_cast<int>(cached->size())));
+    v8::MaybeLocal<v8::Script> script = v8::ScriptCompiler::Compile(
+        context, &cachedSource, v8::ScriptCompiler::kConsumeCodeCache);
+    if (!cachedSource.GetCachedData()->rejected)
+      return script;
+    discard(key);
+    if (!script.IsEmpty())
+      return script;
+  }
+
+#ifdef SCRIPT_CACHE_CREATE_CODE_CACHE
+  v8::ScriptCompiler::Source plainSource(code, origin);
+  v8::MaybeLocal<v8::Script> script =
+      v8::ScriptCompiler::Compile(context, &plainSource);
+  if (!script.IsEmpty()) {
+    std::unique_ptr<v8::ScriptCompiler::CachedData> data(
+        v8::ScriptCompiler::CreateCodeCache(
+            script.ToLocalChecked()->GetUnboundScript()));
+    if (data)
+      store(key, data->data, data->length);
+  }
+#else
+  v8::ScriptCompiler::Source plainSource(code, origin);
+  v8::MaybeLocal<v8::Script> script = v8::ScriptCompiler::Compile(
+      context, &plainSource, v8::ScriptCompiler::kProduceCodeCache);
+  const v8::ScriptCompiler::CachedData *data = plainSource.GetCachedData();
+  if (!script.IsEmpty() && data)
+    store(key, data->data, data->length);
+#endif
+  return script;
+}
@@ -0,0 +1,20 @@
+#ifndef SCRIPT_CACHE_HPP
+#define SCRIPT_CACHE_HPP
+
+#include <nan.h>
+#include <string>
+
+// ScriptCache compiles dissector scripts through a V8 code cache shared by
+// every isolate in the process. The first compilation of a source produces
+// the cache and stores it in memory and in a per-user cache dir
+// ($XDG_CACHE_HOME or ~/.cache, %LOCALAPPDATA% on Windows); later
+// compilations in other threads, sessions or processes consume it instead
+// of parsing again.
+class ScriptCache {
+public:
+  static Nan::MaybeLocal<Nan::BoundScript>
+  compile(v8::Isolate *isolate, const std::string &source,
+          const std::string &resourceName);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "serialization.hpp"
+#include "buffer.hpp"
+#include <vector>
+
+void writeString(std::ostream &os, const std::string &str) {
+  writeValue<uint32_t>(os, str.size());
+  os.write(str.data(), str.size());
+}
+
+std::string readString(std::istream &is) {
+  std::string str(readValue<uint32_t>(is), '\0');
+  is.read(&str[0], str.size());
+  return str;
+}
+
+void writeBuffer(std::ostream &os, const Buffer *buffer) {
+  writeValue<bool>(os, buffer != nullptr);
+  if (buffer) {
+    writeValue<uint32_t>(os, buffer->length());
+    os.write(buffer->data(), buffer->length());
+  }
+}
+
+std::unique_ptr<Buffer> readBuffer(std::istream &is) {
+  if (!readValue<bool>(is))
+    return nullptr;
+  auto data = std::make_shared<std::vector<char>>(readValue<uint32_t>(is));
+  is.read(data->data(), data->size());
+  std::unique_ptr<Buffer> buffer(new Buffer(data));
+  buffer->freeze();
+  return buffer;
+}
@@ -0,0 +1,28 @@
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+class Buffer;
+
+template <class T> void writeValue(std::ostream &os, const T &value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <class T> T readValue(std::istream &is) {
+  T value = T();
+  is.read(reinterpret_cast<char *>(&value), sizeof(value));
+  return value;
+}
+
+void writeString(std::ostream &os, const std::string &str);
+std::string readString(std::istream &is);
+
+void writeBuffer(std::ostream &os, const Buffer *buffer);
+std::unique_ptr<Buffer> readBuffer(std::istream &is);
+
+#endif
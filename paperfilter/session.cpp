@@ -1,11 +1,15 @@
 #include "session.hpp"
 #include "buffer.hpp"
 #include "dissector.hpp"
+#include "field_index.hpp"
 #include "packet_dispatcher.hpp"
+#include "filter_dispatcher.hpp"
 #include "filter_thread.hpp"
 #include "layer.hpp"
+#include "layer_id_table.hpp"
 #include "packet.hpp"
 #include "packet_store.hpp"
+#include "roaring_bitmap.hpp"
 #include "pcap.hpp"
 #include "permission.hpp"
 #include "stream_chunk.hpp"
@@ -13,6 +17,7 @@
 #include "log_message.hpp"
 #include <nan.h>
 #include <thread>
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <unordered_set>
@@ -23,9 +28,18 @@
 
 using namespace v8;
 
+namespace {
+const int maxCombineDepth = 8;
+}
+
 struct FilterContext {
-  std::vector<std::unique_ptr<FilterThread>> threads;
-  std::shared_ptr<FilterThread::Context> ctx;
+  std::shared_ptr<FilterTask> task;
+
+  // Views combined from other named filters by Session::combine().
+  std::string op;
+  std::vector<std::string> sources;
+  std::vector<std::pair<const FilterTask *, uint32_t>> sourceState;
+
   std::chrono::time_point<std::chrono::system_clock> startTime =
       std::chrono::system_clock::now();
   uint32_t initialMaxSeq = 0;
@@ -37,11 +51,13 @@ public:
   ~Private();
   void log(const LogMessage &msg);
   v8::Local<v8::Object> status();
+  void updateCombined(FilterContext *context, int depth = 0);
 
 public:
   std::unique_ptr<PacketStore> store;
   std::unique_ptr<PacketDispatcher> packetDispatcher;
-  std::unordered_map<std::string, FilterContext> filterThreads;
+  std::unique_ptr<FilterDispatcher> filterDispatcher;
+  std::unordered_map<std::string, FilterContext> filters;
   std::string ns;
   std::string config;
 
@@ -59,6 +75,9 @@ public:
   uint32_t prevQueue = 0;
   bool capturing = false;
   int threads;
+  size_t memoryBudget = 0;
+  bool lazy = false;
+  bool nativeFilter = true;
 };
 
 Session::Private::Private() {
@@ -137,12 +156,16 @@ v8::Local<v8::Object> Session::Private::status() {
   v8pp::set_option(isolate, obj, "capturing", capturing);
   v8pp::set_option(isolate, obj, "packets", packets);
   v8pp::set_option(isolate, obj, "queue", queue);
+  v8pp::set_option(isolate, obj, "dropped",
+                   static_cast<double>(packetDispatcher->droppedPackets()));
   Local<Object> filtered = Object::New(isolate);
+  Local<Object> filteredSeq = Object::New(isolate);
 
-  for (auto &pair : filterThreads) {
+  for (auto &pair : filters) {
     FilterContext &context = pair.second;
+    updateCombined(&context);
     if (context.initialMaxSeq > 0 &&
-        context.ctx->packets.maxSeq() >= context.initialMaxSeq) {
+        context.task->packets.maxSeq() >= context.initialMaxSeq) {
       int ms = std::chrono::duration_cast<std::chrono::milliseconds>(
                    std::chrono::system_clock::now() - context.startTime)
                    .count();
@@ -156,13 +179,80 @@ v8::Local<v8::Object> Session::Private::status() {
       context.initialMaxSeq = 0;
     }
     v8pp::set_option(isolate, filtered, pair.first.c_str(),
-                     context.ctx->packets.size());
+                     context.task->packets.size());
+    v8pp::set_option(isolate, filteredSeq, pair.first.c_str(),
+                     context.task->packets.maxSeq());
   }
 
   v8pp::set_option(isolate, obj, "filtered", filtered);
+  v8pp::set_option(isolate, obj, "filteredSeq", filteredSeq);
   return obj;
 }
 
+void Session::Private::updateCombined(FilterContext *context, int depth) {
+  if (context->op.empty() || depth > maxCombineDepth)
+    return;
+
+  std::vector<std::pair<const FilterTask *, uint32_t>> state;
+  for (const std::string &name : context->sources) {
+    auto it = filters.find(name);
+    if (it == filters.end()) {
+      state.emplace_back(nullptr, 0);
+      continue;
+    }
+    updateCombined(&it->second, depth + 1);
+    const FilterTask *task = it->second.task.get();
+    state.emplace_back(task, task->packets.maxSeq());
+  }
+  if (state == context->sourceState)
+    return;
+
+  // Seqs up to the previous maxSeq were decided by every source and stay
+  // as they are, so only the partitions from the one holding it on are
+  // combined again, unless a source was replaced or went back.
+  uint32_t fromSeq = context->task->packets.maxSeq();
+  if (context->sourceState.size() != state.size()) {
+    fromSeq = 0;
+  } else {
+    for (size_t i = 0; i < state.size(); ++i) {
+      if (!state[i].first ||
+          state[i].first != context->sourceState[i].first ||
+          state[i].second < context->sourceState[i].second) {
+        fromSeq = 0;
+        break;
+      }
+    }
+  }
+  fromSeq &= ~uint32_t(0xffff);
+  context->sourceState = state;
+
+  // The view only covers the seqs every source has already decided.
+  RoaringBitmap matches;
+  uint32_t maxSeq = 0;
+  for (size_t i = 0; i < state.size(); ++i) {
+    if (!state[i].first) {
+      matches = RoaringBitmap();
+      maxSeq = 0;
+      break;
+    }
+    uint32_t seq = 0;
+    const RoaringBitmap &source =
+        state[i].first->packets.matches(fromSeq, &seq);
+    if (i == 0) {
+      matches = source;
+      maxSeq = seq;
+    } else {
+      matches = (context->op == "or") ? (matches | source) : (matches & source);
+      maxSeq = std::min(maxSeq, seq);
+    }
+  }
+  if (context->op == "not") {
+    matches = RoaringBitmap::range(std::max<uint32_t>(fromSeq, 1), maxSeq)
+                  .andNot(matches);
+  }
+  context->task->packets.assign(fromSeq, matches, maxSeq);
+}
+
 void Session::Private::log(const LogMessage &msg) {
   {
     std::lock_guard<std::mutex> lock(errorMutex);
@@ -172,10 +262,11 @@ void Session::Private::log(const LogMessage &msg) {
 }
 
 Session::Private::~Private() {
-  filterThreads.clear();
+  filterDispatcher.reset();
   streamDispatcher.reset();
   packetDispatcher.reset();
   pcap.reset();
+  store.reset();
   uv_close((uv_handle_t *)&statusCbAsync, nullptr);
   uv_close((uv_handle_t *)&logCbAsync, nullptr);
 }
@@ -189,40 +280,61 @@ Session::~Session() {
   d = nullptr;
 }
 
-void Session::analyze(std::unique_ptr<Packet> pkt) {
+void Session::analyze(std::unique_ptr<Packet> pkt, bool capture) {
   const auto &layer = std::make_shared<Layer>(d->ns);
   layer->setName("Frame");
   layer->setPayload(pkt->payload());
   pkt->addLayer(layer);
-  d->packetDispatcher->analyze(std::move(pkt));
+  d->packetDispatcher->analyze(std::move(pkt), capture);
 }
 
-void Session::analyze(std::vector<std::unique_ptr<Packet>> packets) {
+void Session::analyze(std::vector<std::unique_ptr<Packet>> packets,
+                      bool capture) {
   for (auto &pkt : packets) {
     const auto &layer = std::make_shared<Layer>(d->ns);
     layer->setName("Frame");
     layer->setPayload(pkt->payload());
     pkt->addLayer(layer);
   }
-  d->packetDispatcher->analyze(std::move(packets));
+  d->packetDispatcher->analyze(std::move(packets), capture);
 }
 
 void Session::filter(const std::string &name, const std::string &filter) {
-  d->filterThreads.erase(name);
+  d->filters.erase(name);
+  d->filterDispatcher->removeTask(name);
 
   if (!filter.empty()) {
-    FilterContext &context = d->filterThreads[name];
+    FilterContext &context = d->filters[name];
     context.initialMaxSeq = d->store->maxSeq();
-    context.ctx = std::make_shared<FilterThread::Context>();
-    context.ctx->store = d->store.get();
-    context.ctx->filter = filter;
-    context.ctx->packets.addHandler(
-        [this](uint32_t seq) { uv_async_send(&d->statusCbAsync); });
-    context.ctx->logCb =
-        std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-    for (int i = 0; i < d->threads; ++i) {
-      context.threads.emplace_back(new FilterThread(context.ctx));
+    context.task = d->filterDispatcher->findTask(filter);
+    if (!context.task) {
+      context.task = std::make_shared<FilterTask>();
+      context.task->filter = filter;
+      context.task->packets.addHandler(
+          [this](uint32_t seq) { uv_async_send(&d->statusCbAsync); });
     }
+    d->filterDispatcher->setTask(name, context.task);
+  }
+
+  uv_async_send(&d->statusCbAsync);
+}
+
+void Session::combine(const std::string &name, const std::string &op,
+                      const std::vector<std::string> &sources) {
+  d->filters.erase(name);
+  d->filterDispatcher->removeTask(name);
+
+  bool valid = (op == "and" || op == "or")
+                   ? !sources.empty()
+                   : (op == "not" && sources.size() == 1);
+  if (valid) {
+    FilterContext &context = d->filters[name];
+    context.op = op;
+    context.sources = sources;
+    context.task = std::make_shared<FilterTask>();
+    context.task->packets.addHandler(
+        [this](uint32_t seq) { uv_async_send(&d->statusCbAsync); });
+    d->updateCombined(&context);
   }
 
   uv_async_send(&d->statusCbAsync);
@@ -245,15 +357,57 @@ void Session::setStatusCallback(const Local<Function> &cb) {
 }
 
 std::shared_ptr<const Packet> Session::get(uint32_t seq) const {
-  return d->store->get(seq);
+  std::shared_ptr<Packet> pkt = d->store->get(seq);
+  if (pkt && d->lazy)
+    d->store->updateUsage(d->packetDispatcher->dissect({pkt}, true));
+  return pkt;
 }
 
 std::vector<uint32_t> Session::getFiltered(const std::string &name,
                                            uint32_t start, uint32_t end) const {
-  const auto it = d->filterThreads.find(name);
-  if (it == d->filterThreads.end())
+  const auto it = d->filters.find(name);
+  if (it == d->filters.end())
     return std::vector<uint32_t>();
-  return it->second.ctx->packets.get(start, end);
+  d->updateCombined(&it->second);
+  return it->second.task->packets.get(start, end);
+}
+
+std::vector<uint32_t> Session::getFilteredRange(const std::string &name,
+                                                uint32_t startSeq,
+                                                uint32_t endSeq) const {
+  const auto it = d->filters.find(name);
+  if (it == d->filters.end())
+    return std::vector<uint32_t>();
+  d->updateCombined(&it->second);
+  return it->second.task->packets.getRange(startSeq, endSeq);
+}
+
+void Session::setViewport(uint32_t start, uint32_t end,
+                          const std::string &name) {
+  if (name.empty()) {
+    d->filterDispatcher->setViewport(start, end);
+    return;
+  }
+
+  const auto it = d->filters.find(name);
+  if (it == d->filters.end())
+    return;
+
+  // Map the visible indices of the filtered view to seqs. Indices beyond
+  // the known results are extrapolated from the current match ratio.
+  const FilteredPacketStore &packets = it->second.task->packets;
+  uint32_t size = packets.size();
+  uint32_t maxSeq = packets.maxSeq();
+  auto seqAt = [&](uint32_t index) -> uint32_t {
+    if (index < size)
+      return packets.get(index);
+    uint64_t rest = index - size + 1;
+    if (size > 0)
+      rest = rest * maxSeq / size;
+    return static_cast<uint32_t>(
+        std::min<uint64_t>(maxSeq + rest, UINT32_MAX));
+  };
+  d->filterDispatcher->setViewport(seqAt(start), seqAt(end));
 }
 
 std::string Session::ns() const { return d->ns; }
@@ -320,6 +474,46 @@ void Session::reset(v8::Local<v8::Object> opt) {
   v8pp::get_option(isolate, opt, "threads", d->threads);
   d->threads = std::max(1, d->threads - 1);
 
+  double memoryBudget = 0;
+  v8pp::get_option(isolate, opt, "memory_budget", memoryBudget);
+  d->memoryBudget = std::max(0.0, memoryBudget);
+
+  d->lazy = false;
+  v8pp::get_option(isolate, opt, "lazy", d->lazy);
+
+  d->nativeFilter = true;
+  v8pp::get_option(isolate, opt, "native_filter", d->nativeFilter);
+
+  double queueLimit = 0;
+  v8pp::get_option(isolate, opt, "queue_limit", queueLimit);
+  std::string queuePolicy = "block";
+  v8pp::get_option(isolate, opt, "queue_policy", queuePolicy);
+
+  Local<Array> indexArray;
+  std::vector<std::string> indexFields;
+  if (v8pp::get_option(isolate, opt, "field_index", indexArray)) {
+    for (uint32_t i = 0; i < indexArray->Length(); ++i) {
+      indexFields.push_back(
+          v8pp::from_v8<std::string>(isolate, indexArray->Get(i), ""));
+    }
+  }
+  auto fieldIndex = std::make_shared<FieldIndex>(indexFields);
+  auto layerIds = std::make_shared<LayerIdTable>();
+
+  // Filter threads may call into the packet dispatcher in lazy mode, so
+  // they are stopped before it is replaced.
+  std::vector<std::pair<std::string, std::string>> filters;
+  std::vector<std::pair<std::string, FilterContext>> combined;
+  for (const auto &pair : d->filters) {
+    if (pair.second.op.empty()) {
+      filters.push_back(std::make_pair(pair.first, pair.second.task->filter));
+    } else {
+      combined.push_back(pair);
+    }
+  }
+  d->filters.clear();
+  d->filterDispatcher.reset();
+
   Local<Array> dissectorArray;
   std::vector<Dissector> dissectors;
   if (v8pp::get_option(isolate, opt, "dissectors", dissectorArray)) {
@@ -343,18 +537,40 @@ void Session::reset(v8::Local<v8::Object> opt) {
     }
   }
 
+  // Stream dissectors need every packet dissected once and in seq order,
+  // which lazy dissection never guarantees.
+  if (d->lazy && !streamDissectors.empty()) {
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_WARN;
+    msg.message = "Stream dissectors are disabled in lazy mode";
+    msg.domain = "session";
+    d->log(msg);
+    streamDissectors.clear();
+  }
+
   auto dissCtx = std::make_shared<PacketDispatcher::Context>();
   dissCtx->threads = d->threads;
+  dissCtx->lazy = d->lazy;
+  dissCtx->queueLimit = std::max(0.0, queueLimit);
+  if (queuePolicy == "drop_newest") {
+    dissCtx->queuePolicy = PacketDispatcher::POLICY_DROP_NEWEST;
+  } else if (queuePolicy == "drop_count") {
+    dissCtx->queuePolicy = PacketDispatcher::POLICY_DROP_COUNT;
+  }
   dissCtx->config = d->config;
-  dissCtx->packetCb = [this](
+  dissCtx->layerIds = layerIds;
+  dissCtx->packetCb = [this, fieldIndex](
       const std::vector<std::shared_ptr<Packet>> &packets) {
+    fieldIndex->insert(packets);
     d->store->insert(packets);
   };
-  dissCtx->streamsCb = [this](
-      uint32_t seq, std::vector<std::unique_ptr<StreamChunk>> streams) {
-    if (d->streamDispatcher)
-      d->streamDispatcher->insert(seq, std::move(streams));
-  };
+  if (!d->lazy) {
+    dissCtx->streamsCb = [this](
+        uint32_t seq, std::vector<std::unique_ptr<StreamChunk>> streams) {
+      if (d->streamDispatcher)
+        d->streamDispatcher->insert(seq, std::move(streams));
+    };
+  }
   dissCtx->dissectors.swap(dissectors);
   dissCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
   d->packetDispatcher.reset(new PacketDispatcher(dissCtx));
@@ -380,30 +596,56 @@ void Session::reset(v8::Local<v8::Object> opt) {
   auto pcapCtx = std::make_shared<Pcap::Context>();
   pcapCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
   pcapCtx->packetCb = [this](std::unique_ptr<Packet> pkt) {
-    analyze(std::move(pkt));
+    analyze(std::move(pkt), true);
+  };
+  pcapCtx->packetsCb = [this](std::vector<std::unique_ptr<Packet>> packets) {
+    analyze(std::move(packets), true);
   };
   d->pcap.reset(new Pcap(pcapCtx));
 
-  std::vector<std::shared_ptr<Packet>> packets;
-  if (d->store) {
-    packets = d->store->get(1, d->store->maxSeq());
-  }
+  std::unique_ptr<PacketStore> oldStore = std::move(d->store);
   auto storeCb = [this](uint32_t maxSeq) { uv_async_send(&d->statusCbAsync); };
-  d->store.reset(new PacketStore());
+  d->store.reset(new PacketStore(
+      d->memoryBudget,
+      std::bind(&Private::log, std::ref(d), std::placeholders::_1)));
   d->store->addHandler(storeCb);
 
-  std::vector<std::pair<std::string, std::string>> filters;
-  for (const auto &pair : d->filterThreads) {
-    filters.push_back(std::make_pair(pair.first, pair.second.ctx->filter));
+  auto filterCtx = std::make_shared<FilterDispatcher::Context>();
+  filterCtx->threads = d->threads;
+  filterCtx->store = d->store.get();
+  if (!fieldIndex->empty())
+    filterCtx->index = fieldIndex;
+  filterCtx->layerIds = layerIds;
+  filterCtx->native = d->nativeFilter;
+  filterCtx->logCb =
+      std::bind(&Private::log, std::ref(d), std::placeholders::_1);
+  if (d->lazy) {
+    filterCtx->dissectCb = [this, fieldIndex](
+        const std::vector<std::shared_ptr<Packet>> &packets) {
+      d->store->updateUsage(d->packetDispatcher->dissect(packets));
+      fieldIndex->insert(packets);
+    };
   }
-  d->filterThreads.clear();
+  d->filterDispatcher.reset(new FilterDispatcher(filterCtx));
+
   for (const auto &pair : filters) {
     filter(pair.first, pair.second);
   }
+  for (const auto &pair : combined) {
+    combine(pair.first, pair.second.op, pair.second.sources);
+  }
 
-  for (const auto &pkt : packets) {
-    if (!pkt->vpacket()) {
-      analyze(pkt->shallowClone());
+  // Re-analyze in chunks so that spilled packets are not all faulted
+  // back into memory at once.
+  if (oldStore) {
+    const uint32_t chunk = 4096;
+    uint32_t maxSeq = oldStore->maxSeq();
+    for (uint32_t start = 1; start <= maxSeq; start += chunk) {
+      for (const auto &pkt : oldStore->get(start, start + chunk - 1)) {
+        if (pkt && !pkt->vpacket()) {
+          analyze(pkt->shallowClone());
+        }
+      }
     }
   }
 
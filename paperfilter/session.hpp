@@ -20,12 +20,20 @@ public:
   v8::Local<v8::Function> statusCallback() const;
   void setStatusCallback(const v8::Local<v8::Function> &cb);
 
-  void analyze(std::unique_ptr<Packet> pkt);
-  void analyze(std::vector<std::unique_ptr<Packet>> packets);
+  void analyze(std::unique_ptr<Packet> pkt, bool capture = false);
+  void analyze(std::vector<std::unique_ptr<Packet>> packets,
+               bool capture = false);
   void filter(const std::string &name, const std::string &filter);
+  void combine(const std::string &name, const std::string &op,
+               const std::vector<std::string> &sources);
   std::shared_ptr<const Packet> get(uint32_t seq) const;
   std::vector<uint32_t> getFiltered(const std::string &name, uint32_t start,
                                     uint32_t end) const;
+  std::vector<uint32_t> getFilteredRange(const std::string &name,
+                                         uint32_t startSeq,
+                                         uint32_t endSeq) const;
+  void setViewport(uint32_t start, uint32_t end,
+                   const std::string &name = std::string());
 
   std::string ns() const;
 
@@ -83,7 +83,8 @@ public:
       const auto &items = wrapper->item->items();
       v8::Local<v8::Array> array = v8::Array::New(isolate, items.size());
       for (size_t i = 0; i < items.size(); ++i) {
-        array->Set(i, SessionItemWrapper::create(items[i]));
+        std::shared_ptr<Item> child(wrapper->item, items[i].get());
+        array->Set(i, SessionItemWrapper::create(child));
       }
       obj = array;
       wrapper->itemsCache = v8::UniquePersistent<v8::Object>(isolate, obj);
@@ -107,6 +108,7 @@ public:
     }
   }
 
+  // |item| shares ownership with its packet, which owns the item's arena.
   static v8::Local<v8::Object> create(const std::shared_ptr<Item> &item) {
     v8::Local<v8::Function> cons = Nan::New(constructor());
     v8::Local<v8::Value> argv[1] = {
@@ -104,8 +104,9 @@ public:
       if (wrapper->layersCache.IsEmpty()) {
         obj = v8::Object::New(isolate);
         for (const auto &pair : layer->layers()) {
-          obj->Set(v8pp::to_v8(isolate, pair.first),
-                   SessionLayerWrapper::create(pair.second));
+          obj->Set(v8pp::to_v8(isolate, pair.first.str()),
+                   SessionLayerWrapper::create(
+                       std::shared_ptr<const Layer>(layer, pair.second.get())));
         }
         wrapper->layersCache = v8::UniquePersistent<v8::Object>(isolate, obj);
       } else {
@@ -128,7 +129,8 @@ public:
         const auto &items = layer->items();
         v8::Local<v8::Array> array = v8::Array::New(isolate, items.size());
         for (size_t i = 0; i < items.size(); ++i) {
-          array->Set(i, SessionItemWrapper::create(items[i]));
+          array->Set(i, SessionItemWrapper::create(
+                            std::shared_ptr<Item>(layer, items[i].get())));
         }
         obj = array;
         wrapper->itemsCache = v8::UniquePersistent<v8::Object>(isolate, obj);
@@ -177,6 +179,7 @@ public:
     }
   }
 
+  // |layer| shares ownership with its packet, which owns the layer's arena.
   static v8::Local<v8::Object> create(const std::weak_ptr<const Layer> &layer) {
     v8::Local<v8::Function> cons = Nan::New(constructor());
     v8::Local<v8::Value> argv[1] = {
@@ -110,8 +110,9 @@ public:
       if (wrapper->layersCache.IsEmpty()) {
         obj = v8::Object::New(isolate);
         for (const auto &pair : pkt->layers()) {
-          obj->Set(v8pp::to_v8(isolate, pair.first),
-                   SessionLayerWrapper::create(pair.second));
+          obj->Set(v8pp::to_v8(isolate, pair.first.str()),
+                   SessionLayerWrapper::create(
+                       std::shared_ptr<const Layer>(pkt, pair.second.get())));
         }
         wrapper->layersCache = v8::UniquePersistent<v8::Object>(isolate, obj);
       } else {
@@ -159,13 +160,13 @@ public:
         ObjectWrap::Unwrap<SessionPacketWrapper>(info.Holder());
 
     if (const std::shared_ptr<const Packet> &pkt = wrapper->pkt.lock()) {
-      const std::string &id = v8pp::from_v8<std::string>(isolate, info[0], "");
+      // Looked up by string, since ids past the atom limit are not
+      // interned.
+      const std::string &id =
+          v8pp::from_v8<std::string>(isolate, info[0], "");
 
-      std::function<std::shared_ptr<Item>(
-          const std::unordered_map<std::string, std::shared_ptr<Layer>> &)>
-          findItem = [id, &findItem](
-              const std::unordered_map<std::string, std::shared_ptr<Layer>>
-                  &layers) -> std::shared_ptr<Item> {
+      std::function<std::shared_ptr<Item>(const LayerMap &)> findItem =
+          [&id, &findItem](const LayerMap &layers) -> std::shared_ptr<Item> {
 
         if (layers.empty())
           return std::shared_ptr<Item>();
@@ -20,8 +20,11 @@ public:
     tpl->SetClassName(Nan::New("Session").ToLocalChecked());
     SetPrototypeMethod(tpl, "analyze", analyze);
     SetPrototypeMethod(tpl, "filter", filter);
+    SetPrototypeMethod(tpl, "combine", combine);
     SetPrototypeMethod(tpl, "get", get);
     SetPrototypeMethod(tpl, "getFiltered", getFiltered);
+    SetPrototypeMethod(tpl, "getFilteredRange", getFilteredRange);
+    SetPrototypeMethod(tpl, "setViewport", setViewport);
     v8::Local<v8::ObjectTemplate> otl = tpl->InstanceTemplate();
     Nan::SetAccessor(otl, Nan::New("logCallback").ToLocalChecked(), logCallback,
                      setLogCallback);
@@ -86,6 +89,22 @@ public:
     }
   }
 
+  static NAN_METHOD(combine) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    v8::Isolate *isolate = v8::Isolate::GetCurrent();
+    const auto &name = Nan::Utf8String(info[0]);
+    const auto &op = Nan::Utf8String(info[1]);
+    std::vector<std::string> sources;
+    if (info[2]->IsArray()) {
+      sources = v8pp::from_v8<std::vector<std::string>>(isolate, info[2]);
+    }
+    if (*name && *op) {
+      wrapper->session->combine(*name, *op, sources);
+    }
+  }
+
   static NAN_GETTER(logCallback) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -148,6 +167,36 @@ public:
     info.GetReturnValue().Set(array);
   }
 
+  static NAN_METHOD(getFilteredRange) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+
+    v8::Isolate *isolate = v8::Isolate::GetCurrent();
+    const std::string &name = v8pp::from_v8<std::string>(isolate, info[0], "");
+    uint32_t start = v8pp::from_v8<uint32_t>(isolate, info[1], 0);
+    uint32_t end = v8pp::from_v8<uint32_t>(isolate, info[2], 0);
+    const std::vector<uint32_t> &seq =
+        wrapper->session->getFilteredRange(name, start, end);
+    v8::Local<v8::Array> array = v8::Array::New(isolate, seq.size());
+    for (uint32_t i = 0; i < seq.size(); ++i) {
+      array->Set(i, v8::Number::New(isolate, seq[i]));
+    }
+    info.GetReturnValue().Set(array);
+  }
+
+  static NAN_METHOD(setViewport) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+
+    v8::Isolate *isolate = v8::Isolate::GetCurrent();
+    uint32_t start = v8pp::from_v8<uint32_t>(isolate, info[0], 0);
+    uint32_t end = v8pp::from_v8<uint32_t>(isolate, info[1], 0);
+    const std::string &name = v8pp::from_v8<std::string>(isolate, info[2], "");
+    wrapper->session->setViewport(start, end, name);
+  }
+
   static NAN_GETTER(ns) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
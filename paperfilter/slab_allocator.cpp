@@ -0,0 +1,46 @@
+#include "slab_allocator.hpp"
+#include "buffer.hpp"
+#include <cstring>
+
+namespace {
+const size_t slabAlignment = 16;
+}
+
+class SlabAllocator::Private {
+public:
+  size_t slabSize;
+  std::shared_ptr<char> slab;
+  size_t offset = 0;
+};
+
+SlabAllocator::SlabAllocator(size_t slabSize) : d(new Private()) {
+  d->slabSize = slabSize;
+}
+
+SlabAllocator::~SlabAllocator() {}
+
+size_t SlabAllocator::footprint(size_t length) const {
+  if (length > d->slabSize / 4)
+    return length;
+  return (length + slabAlignment - 1) & ~(slabAlignment - 1);
+}
+
+std::unique_ptr<Buffer> SlabAllocator::copy(const char *data, size_t length) {
+  if (length > d->slabSize / 4) {
+    std::shared_ptr<char> chunk(new char[length],
+                                std::default_delete<char[]>());
+    std::memcpy(chunk.get(), data, length);
+    return std::unique_ptr<Buffer>(new Buffer(chunk, length));
+  }
+
+  if (!d->slab || d->offset + length > d->slabSize) {
+    d->slab.reset(new char[d->slabSize], std::default_delete<char[]>());
+    d->offset = 0;
+  }
+
+  char *head = d->slab.get() + d->offset;
+  std::memcpy(head, data, length);
+  d->offset += footprint(length);
+  return std::unique_ptr<Buffer>(
+      new Buffer(std::shared_ptr<const char>(d->slab, head), length));
+}
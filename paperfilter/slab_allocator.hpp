@@ -0,0 +1,24 @@
+#ifndef SLAB_ALLOCATOR_HPP
+#define SLAB_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <memory>
+
+class Buffer;
+
+class SlabAllocator {
+public:
+  explicit SlabAllocator(size_t slabSize = 4 << 20);
+  ~SlabAllocator();
+  SlabAllocator(const SlabAllocator &) = delete;
+  SlabAllocator &operator=(const SlabAllocator &) = delete;
+  std::unique_ptr<Buffer> copy(const char *data, size_t length);
+  // Bytes that copy() takes for |length| bytes, including the padding.
+  size_t footprint(size_t length) const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
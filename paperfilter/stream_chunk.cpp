@@ -11,6 +11,8 @@ class StreamChunk::Private {
 public:
   std::string ns;
   std::string id;
+  // Keeps the arena of a dissected layer alive; see LayerArena.
+  std::shared_ptr<Packet> pkt;
   std::shared_ptr<Layer> layer;
   std::unordered_map<std::string, ItemValue> attrs;
   bool end = false;
@@ -25,7 +27,7 @@ StreamChunk::StreamChunk(v8::Local<v8::Object> obj)
   v8::Local<v8::Object> layerObj;
   if (v8pp::get_option(isolate, obj, "layer", layerObj)) {
     if (Layer *layer = v8pp::class_<Layer>::unwrap_object(isolate, layerObj)) {
-      d->layer = std::make_shared<Layer>(*layer);
+      setLayer(std::make_shared<Layer>(*layer));
     }
   }
 
@@ -42,6 +44,12 @@ StreamChunk::StreamChunk(v8::Local<v8::Object> obj)
   }
 }
 
+StreamChunk::StreamChunk(const std::string &ns, const std::string &id)
+    : d(std::make_shared<Private>()) {
+  d->ns = ns;
+  d->id = id;
+}
+
 StreamChunk::StreamChunk(const StreamChunk &stream) : d(stream.d) {}
 
 StreamChunk::~StreamChunk() {}
@@ -53,6 +61,7 @@ std::string StreamChunk::id() const { return d->id; }
 std::shared_ptr<Layer> StreamChunk::layer() const { return d->layer; }
 
 void StreamChunk::setLayer(const std::shared_ptr<Layer> &layer) {
+  d->pkt = layer ? layer->packet() : nullptr;
   d->layer = layer;
 }
 
@@ -69,6 +78,10 @@ void StreamChunk::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   }
 }
 
+void StreamChunk::setAttr(const std::string &name, const ItemValue &value) {
+  d->attrs.emplace(name, value);
+}
+
 std::unordered_map<std::string, ItemValue> StreamChunk::attrs() const {
   return d->attrs;
 }
@@ -1,4 +1,5 @@
 #include "stream_dispatcher.hpp"
+#include "namespace_table.hpp"
 #include "stream_chunk.hpp"
 #include "stream_dissector_thread.hpp"
 #include <chrono>
@@ -37,6 +38,8 @@ StreamDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
   dissCtx->dissectors = ctx->dissectors;
+  dissCtx->namespaces = std::make_shared<NamespaceTable>(
+      NamespaceTable::load(ctx->dissectors, ctx->logCb));
   for (int i = 0; i < ctx->threads; ++i) {
     dissectorThreads.emplace_back(new StreamDissectorThread(dissCtx));
   }
@@ -50,6 +53,11 @@ StreamDispatcher::~StreamDispatcher() {}
 void StreamDispatcher::insert(
     uint32_t seq, std::vector<std::unique_ptr<StreamChunk>> streamChunks) {
   std::lock_guard<std::mutex> lock(d->mutex);
+
+  // Chunks of an already released seq come from a packet that was
+  // dissected again; feeding them twice would corrupt the streams.
+  if (seq <= d->maxSeq)
+    return;
   d->streamChunks[seq] = std::move(streamChunks);
 
   auto it = d->streamChunks.begin();
@@ -1,8 +1,11 @@
 #include "stream_dissector_thread.hpp"
 #include "log_message.hpp"
+#include "namespace_table.hpp"
 #include "layer.hpp"
 #include "packet.hpp"
+#include "isolate_pool.hpp"
 #include "paper_context.hpp"
+#include "script_cache.hpp"
 #include "stream_chunk.hpp"
 #include "console.hpp"
 #include <condition_variable>
@@ -21,19 +24,7 @@
 using namespace v8;
 
 namespace {
-class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
-public:
-  ArrayBufferAllocator() {}
-  ~ArrayBufferAllocator() {}
-
-  virtual void *Allocate(size_t size) { return calloc(1, size); }
-  virtual void *AllocateUninitialized(size_t size) { return malloc(size); }
-  virtual void Free(void *data, size_t) { free(data); }
-};
-
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
   v8::UniquePersistent<v8::Function> func;
 };
 }
@@ -42,11 +33,6 @@ class StreamDissectorThread::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
   ~Private();
-  const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-          *nsMap);
 
 public:
   std::thread thread;
@@ -63,20 +49,11 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
 
   thread = std::thread([this]() {
     Context &ctx = *this->ctx;
-    v8::Isolate::CreateParams create_params;
-    create_params.array_buffer_allocator = new ArrayBufferAllocator();
-    v8::Isolate *isolate = v8::Isolate::New(create_params);
-
-    // workaround for chromium task runner
-    char dummyData[128] = {0};
-    isolate->SetData(0, dummyData);
+    v8::Isolate *isolate = IsolatePool::acquire();
 
     {
-      std::unique_ptr<v8::Locker> locker;
+      v8::Locker locker(isolate);
       v8::Isolate::Scope isolate_scope(isolate);
-      if (v8::Locker::IsActive()) {
-        locker.reset(new v8::Locker(isolate));
-      }
       v8::HandleScope handle_scope(isolate);
       v8pp::context ppctx(isolate);
       v8::TryCatch try_catch;
@@ -86,17 +63,16 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
           isolate, ctx.logCb, "stream_dissector");
       ppctx.set("console", console);
 
-      std::unordered_map<std::string, DissectorFunc> dissectors;
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
+      std::vector<DissectorFunc> dissectors(ctx.dissectors.size());
 
-      for (const Dissector &diss : ctx.dissectors) {
+      for (size_t index = 0; index < ctx.dissectors.size(); ++index) {
+        const Dissector &diss = ctx.dissectors[index];
         v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
         ppctx.set("module", moduleObj);
 
         v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
+        Nan::MaybeLocal<Nan::BoundScript> script = ScriptCache::compile(
+            isolate, "(function(){" + diss.script + "})()", diss.resourceName);
         if (!script.IsEmpty()) {
           Nan::RunScript(script.ToLocalChecked());
           v8::Local<v8::Value> result =
@@ -123,26 +99,7 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
                                               "stream_dissector"));
           }
         } else {
-          v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
-
-          if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
-              if (ns->IsString()) {
-                stringNamespaces.push_back(
-                    v8pp::from_v8<std::string>(isolate, ns, ""));
-              } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
-              }
-            }
-          }
-
-          dissectors[diss.resourceName] = {
-              stringNamespaces, regexNamespaces,
-              v8::UniquePersistent<v8::Function>(isolate, func)};
+          dissectors[index].func.Reset(isolate, func);
         }
       }
 
@@ -162,8 +119,10 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
         auto it = instances.find(key);
         if (it == instances.end()) {
           std::vector<v8::UniquePersistent<v8::Object>> objs;
-          for (const DissectorFunc *diss :
-               findDessector(chunk->ns(), dissectors, &nsMap)) {
+          for (size_t index : ctx.namespaces->find(Atom(chunk->ns()))) {
+            const DissectorFunc *diss = &dissectors[index];
+            if (diss->func.IsEmpty())
+              continue;
             v8::Local<v8::Function> func =
                 v8::Local<v8::Function>::New(isolate, diss->func);
 
@@ -265,7 +224,7 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
       }
     }
 
-    isolate->Dispose();
+    IsolatePool::release(isolate);
   });
 }
 
@@ -279,40 +238,6 @@ StreamDissectorThread::Private::~Private() {
     thread.join();
 }
 
-const std::vector<const DissectorFunc *> &
-StreamDissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
-    std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-        *nsMap) {
-  static const std::vector<DissectorFunc *> null;
-
-  auto it = nsMap->find(ns);
-  if (it != nsMap->end())
-    return it->second;
-
-  std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
-      }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
-        }
-      }
-    }
-  }
-
-  return funcs;
-}
-
 StreamDissectorThread::StreamDissectorThread(
     const std::shared_ptr<Context> &ctx)
     : d(new Private(ctx)) {}
@@ -9,6 +9,7 @@
 
 class StreamChunk;
 class Layer;
+class NamespaceTable;
 struct LogMessage;
 
 class StreamDissectorThread {
@@ -16,6 +17,7 @@ public:
   struct Context {
     std::string config;
     std::vector<Dissector> dissectors;
+    std::shared_ptr<const NamespaceTable> namespaces;
     std::function<void(const LogMessage &)> logCb;
     std::function<void(std::vector<std::unique_ptr<StreamChunk>>)> streamsCb;
     std::function<void(std::vector<std::unique_ptr<Layer>>)> vpLayersCb;
@@ -0,0 +1,51 @@
+#ifndef WORK_QUEUE_HPP
+#define WORK_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+// WorkQueue is the ingest queue shared by the dissector threads: a
+// mutex-guarded FIFO that workers drain in batches, so the lock is taken
+// once per batch on the consumer side. The item count is kept in an atomic
+// so that producers and sleeping workers can check for work without the
+// lock.
+template <class T> class WorkQueue {
+public:
+  WorkQueue() { count.store(0); }
+  WorkQueue(const WorkQueue &) = delete;
+  WorkQueue &operator=(const WorkQueue &) = delete;
+
+  void push(T value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push(std::move(value));
+    count.fetch_add(1);
+  }
+
+  // Moves up to |max| items into |out| and returns how many were taken.
+  size_t pop(std::vector<T> *out, size_t max) {
+    if (count.load() == 0)
+      return 0;
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t taken = 0;
+    while (taken < max && !queue.empty()) {
+      out->push_back(std::move(queue.front()));
+      queue.pop();
+      ++taken;
+    }
+    count.fetch_sub(taken);
+    return taken;
+  }
+
+  size_t size() const { return count.load(); }
+  bool empty() const { return count.load() == 0; }
+
+private:
+  std::mutex mutex;
+  std::queue<T> queue;
+  std::atomic<size_t> count;
+};
+
+#endif
@@ -0,0 +1,84 @@
+const {Session} = require('paperfilter');
+const msgpack = require('msgpack-lite');
+
+const readers = parseInt(process.env.BENCH_READERS || '4', 10);
+
+Session.create({
+  namespace: '::<Ethernet>',
+  dissectors: [
+    {script: __dirname + '/../../packages/dissector/ethernet/lib/eth.es'}
+  ]
+}).then((sess) => {
+  let packets = [];
+  let rounds = 200;
+  let samples = 256;
+  let maxSeq = 0;
+  let stored = 0;
+  let latencies = [];
+  let time = null;
+  let done = false;
+
+  let sample = () => {
+    if (stored === 0) return;
+    for (let i = 0; i < samples; ++i) {
+      let seq = 1 + Math.floor(Math.random() * stored);
+      let t = process.hrtime();
+      sess.get(seq);
+      let diff = process.hrtime(t);
+      latencies.push(diff[0] * 1000000 + diff[1] / 1000.0);
+    }
+  };
+
+  let feed = (round) => {
+    if (done) return;
+    if (round < rounds) {
+      sess.analyze(packets);
+    }
+    sample();
+    setImmediate(() => feed(round + 1));
+  };
+
+  let report = () => {
+    let diff = process.hrtime(time);
+    let sec = diff[0] + diff[1] / 1000000000.0;
+    latencies.sort((a, b) => a - b);
+    let at = (p) => latencies[Math.min(latencies.length - 1,
+      Math.floor(latencies.length * p))].toFixed(2);
+    console.log(`readers: ${readers} filters`);
+    console.log(`ingest: ${Math.round(maxSeq / sec)}packets/sec`);
+    console.log(`get() samples: ${latencies.length}`);
+    console.log(`get() p50: ${at(0.5)}us p99: ${at(0.99)}us max: ${at(1)}us`);
+    process.exit();
+  };
+
+  sess.on('status', stat => {
+    stored = stat.packets;
+    if (!done && time && stat.packets >= maxSeq && stat.queue === 0) {
+      done = true;
+      report();
+    }
+  });
+
+  let readStream = require('fs').createReadStream(__dirname +  '/../test/dump.msgpack');
+  let decodeStream = msgpack.createDecodeStream();
+  readStream.pipe(decodeStream).on("data", (data) => {
+    if (data.length === 4) {
+      packets.push({
+        ts_sec: data[0],
+        ts_nsec: data[1],
+        length: data[2],
+        payload: data[3]
+      });
+    }
+  }).on('end', () => {
+    for (let i = 0; i < readers; ++i) {
+      sess.filter(`reader${i}`, 'eth');
+    }
+    maxSeq = packets.length * rounds;
+    time = process.hrtime();
+    feed(0);
+  });
+
+}).catch(e => {
+  console.warn(e);
+});
@@ -0,0 +1,74 @@
+const {Session} = require('paperfilter');
+const msgpack = require('msgpack-lite');
+
+Session.create({
+  namespace: '::<Ethernet>',
+  dissectors: [
+    {script: __dirname + '/../../packages/dissector/ethernet/lib/eth.es'}
+  ]
+}).then((sess) => {
+  let packets = [];
+  let repeat = 200;
+  let maxSeq = 0;
+  let filters = [
+    'eth',
+    'eth.len > 100',
+    'eth.src == eth.dst || eth.payload.length >= 64',
+    '!eth.etherType && eth.len % 2 == 0'
+  ];
+  let index = 0;
+  let results = [];
+
+  let next = () => {
+    if (index >= filters.length) {
+      for (let r of results) {
+        console.log(`${r.filter}: ${r.nsec.toFixed(1)}ns/packet`);
+      }
+      process.exit();
+    }
+    sess.filter('bench', filters[index]);
+  };
+
+  sess.on('log', log => {
+    let match = /^Filter \[bench\]: (\d+)packets \/ ([\d.]+)sec$/.exec(log.message);
+    if (match) {
+      let count = parseInt(match[1], 10);
+      let sec = parseFloat(match[2]);
+      let nsec = sec * 1000000000.0 / count;
+      results.push({filter: filters[index], nsec: nsec});
+      console.log(`#${index} ${filters[index]}: ${count}packets ${sec}sec`);
+      index++;
+      next();
+    }
+  });
+
+  let started = false;
+  sess.on('status', stat => {
+    if (!started && stat.packets > 0 && stat.packets >= maxSeq && stat.queue === 0) {
+      started = true;
+      console.log(`store: ${stat.packets}packets`);
+      next();
+    }
+  });
+
+  let readStream = require('fs').createReadStream(__dirname +  '/../test/dump.msgpack');
+  let decodeStream = msgpack.createDecodeStream();
+  readStream.pipe(decodeStream).on("data", (data) => {
+    if (data.length === 4) {
+      packets.push({
+        ts_sec: data[0],
+        ts_nsec: data[1],
+        length: data[2],
+        payload: data[3]
+      });
+    }
+  }).on('end', () => {
+    maxSeq = packets.length * repeat;
+    for (let i = 0; i < repeat; ++i) {
+      sess.analyze(packets);
+    }
+  });
+
+}).catch(e => {
+  console.warn(e);
+});
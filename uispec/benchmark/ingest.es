@@ -0,0 +1,72 @@
+const {Session} = require('paperfilter');
+const msgpack = require('msgpack-lite');
+
+Session.create({
+  namespace: '::<Ethernet>',
+  dissectors: [
+    {script: __dirname + '/../../packages/dissector/ethernet/lib/eth.es'}
+  ]
+}).then((sess) => {
+  let time = null;
+  let count = 0;
+  let maxSeq = 0;
+  let packets = [];
+  let repeat = 100;
+  let results = {single: [], batch: []};
+
+  let mode = () => (count % 2 === 0) ? 'single' : 'batch';
+
+  let start = () => {
+    maxSeq += packets.length * repeat;
+    time = process.hrtime();
+    if (mode() === 'single') {
+      for (let i = 0; i < repeat; ++i) {
+        for (let pkt of packets) {
+          sess.analyze(pkt);
+        }
+      }
+    } else {
+      for (let i = 0; i < repeat; ++i) {
+        sess.analyze(packets);
+      }
+    }
+  };
+
+  sess.on('status', stat => {
+    if (stat.packets > 0 && stat.packets >= maxSeq && stat.queue === 0) {
+      let diff = process.hrtime(time);
+      let sec = diff[0] + diff[1] / 1000000000.0;
+      let pps = packets.length * repeat / sec;
+      results[mode()].push(pps);
+      console.log(`#${count} ${mode()}: ${Math.round(pps)}packets/sec`);
+      count++;
+      if (count >= 20) {
+        for (let key in results) {
+          let sum = results[key].reduce((a, b) => a + b, 0);
+          console.log(`${key} mean: ${Math.round(sum / results[key].length)}packets/sec`);
+        }
+        process.exit();
+      } else {
+        start();
+      }
+    }
+  });
+
+  let readStream = require('fs').createReadStream(__dirname +  '/../test/dump.msgpack');
+  let decodeStream = msgpack.createDecodeStream();
+  readStream.pipe(decodeStream).on("data", (data) => {
+    if (data.length === 4) {
+      packets.push({
+        ts_sec: data[0],
+        ts_nsec: data[1],
+        length: data[2],
+        payload: data[3]
+      });
+    }
+  }).on('end', () => {
+    start();
+  });
+
+}).catch(e => {
+  console.warn(e);
+});
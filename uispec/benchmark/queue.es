@@ -0,0 +1,65 @@
+const {Session} = require('paperfilter');
+const msgpack = require('msgpack-lite');
+
+const threadCounts = (process.env.BENCH_THREADS || '1,2,4,8')
+  .split(',').map(n => parseInt(n, 10));
+
+let packets = [];
+let repeat = 200;
+
+let run = (threads) => {
+  return Session.create({
+    namespace: '::<Ethernet>',
+    dissectors: [
+      {script: __dirname + '/../../packages/dissector/ethernet/lib/eth.es'}
+    ],
+    threads: threads + 1
+  }).then((sess) => {
+    return new Promise((resolve) => {
+      let maxSeq = packets.length * repeat;
+      let time = null;
+      let enqueued = 0;
+
+      sess.on('status', stat => {
+        if (time && stat.packets >= maxSeq && stat.queue === 0) {
+          let diff = process.hrtime(time);
+          let sec = diff[0] + diff[1] / 1000000000.0;
+          console.log(`threads: ${threads} enqueue: ${Math.round(enqueued)}packets/sec` +
+            ` dequeue: ${Math.round(maxSeq / sec)}packets/sec`);
+          time = null;
+          sess.close();
+          resolve();
+        }
+      });
+
+      time = process.hrtime();
+      for (let i = 0; i < repeat; ++i) {
+        for (let pkt of packets) {
+          sess.analyze(pkt);
+        }
+      }
+      let diff = process.hrtime(time);
+      enqueued = maxSeq / (diff[0] + diff[1] / 1000000000.0);
+    });
+  });
+};
+
+let readStream = require('fs').createReadStream(__dirname +  '/../test/dump.msgpack');
+let decodeStream = msgpack.createDecodeStream();
+readStream.pipe(decodeStream).on("data", (data) => {
+  if (data.length === 4) {
+    packets.push({
+      ts_sec: data[0],
+      ts_nsec: data[1],
+      length: data[2],
+      payload: data[3]
+    });
+  }
+}).on('end', () => {
+  threadCounts.reduce((p, n) => p.then(() => run(n)), Promise.resolve())
+    .then(() => process.exit())
+    .catch(e => {
+      console.warn(e);
+      process.exit();
+    });
+});
@@ -0,0 +1,111 @@
+const {Session} = require('paperfilter');
+const dgram = require('dgram');
+
+// Captures known UDP datagrams on the loopback device and checks that each
+// one arrives exactly once with the expected length and a sane timestamp.
+// Needs capture permission; exits with status 0 and a notice without it.
+
+const iface = process.env.CAPTURE_INTERFACE || 'lo';
+const port = parseInt(process.env.CAPTURE_PORT || '47301', 10);
+const count = 256;
+const payloadSize = 64;
+const headerSize = 14 + 20 + 8; // Ethernet + IPv4 + UDP
+const settle = 1000; // msec
+
+if (!Session.permission) {
+  console.log('skipped: no capture permission');
+  process.exit(0);
+}
+
+if (!Session.devices.some(dev => dev.id === iface)) {
+  console.log(`skipped: no such interface: ${iface}`);
+  process.exit(0);
+}
+
+Session.create({
+  namespace: '::<Ethernet>',
+  dissectors: [
+    {script: __dirname + '/../../packages/dissector/ethernet/lib/eth.es'}
+  ]
+}).then((sess) => {
+  let startTime = Date.now() / 1000;
+  let timer = null;
+  let failures = [];
+
+  let fail = (message) => {
+    failures.push(message);
+  };
+
+  let verify = () => {
+    let seen = new Set();
+    let bytes = 0;
+    let total = sess.status.packets;
+    for (let seq = 1; seq <= total; ++seq) {
+      let pkt = sess.get(seq);
+      if (pkt.length !== headerSize + payloadSize) {
+        fail(`#${seq}: unexpected length ${pkt.length}`);
+        continue;
+      }
+      let marker = pkt.payload.readUInt32BE(headerSize);
+      if (seen.has(marker)) {
+        fail(`#${seq}: duplicate datagram ${marker}`);
+      }
+      seen.add(marker);
+      bytes += pkt.length;
+
+      let ts = pkt.ts_sec + pkt.ts_nsec / 1e9;
+      if (pkt.ts_nsec >= 1e9 || Math.abs(ts - startTime) > 60) {
+        fail(`#${seq}: bad timestamp ${pkt.ts_sec}.${pkt.ts_nsec}`);
+      }
+    }
+    if (seen.size !== count) {
+      fail(`captured ${seen.size} of ${count} datagrams`);
+    }
+    if (bytes !== count * (headerSize + payloadSize)) {
+      fail(`captured ${bytes} bytes`);
+    }
+
+    sess.stop();
+    if (failures.length > 0) {
+      failures.forEach(msg => console.warn(msg));
+      process.exit(1);
+    }
+    console.log(`ok: ${count} datagrams, ${bytes} bytes on ${iface}`);
+    process.exit(0);
+  };
+
+  sess.on('log', log => {
+    console.warn(log.message);
+  });
+
+  sess.on('status', stat => {
+    if (stat.packets >= count && stat.queue === 0 && timer == null) {
+      // Wait a little longer so that late duplicates are counted too.
+      timer = setTimeout(verify, settle);
+    }
+  });
+
+  sess.interface = iface;
+  sess.setBPF(`udp and dst port ${port}`);
+  sess.start();
+
+  let socket = dgram.createSocket('udp4');
+  let send = (i) => {
+    if (i >= count) {
+      socket.close();
+      return;
+    }
+    let payload = Buffer.alloc(payloadSize);
+    payload.writeUInt32BE(i, 0);
+    socket.send(payload, port, '127.0.0.1', () => send(i + 1));
+  };
+  setTimeout(() => send(0), 500);
+
+  setTimeout(() => {
+    console.warn(`timeout: captured ${sess.status.packets} packets`);
+    process.exit(1);
+  }, 30000);
+}).catch(e => {
+  console.warn(e);
+  process.exit(1);
+});
@@ -0,0 +1,57 @@
+const {Session} = require('paperfilter');
+const assert = require('assert');
+const {
+  dissectors, loadDump, waitFor, settled, sleep, snapshot
+} = require('./helper.es');
+
+// Fills a session far past a small memory budget, so that most packets are
+// spilled to disk, and checks that get() faults every one of them back
+// exactly as it was dissected.
+const option = (memoryBudget) => ({
+  namespace: '::<Ethernet>',
+  dissectors: dissectors([
+    'ethernet/lib/eth.es', 'ipv4/lib/ipv4.es', 'ipv6/lib/ipv6.es',
+    'tcp/lib/tcp.es', 'udp/lib/udp.es'
+  ]),
+  threads: 2,
+  memory_budget: memoryBudget
+});
+
+const analyze = (packets, memoryBudget) => {
+  return Session.create(option(memoryBudget)).then((sess) => {
+    for (let pkt of packets) {
+      sess.analyze(pkt);
+    }
+    return waitFor(sess, settled(packets.length)).then(() => sess);
+  });
+};
+
+module.exports = () => {
+  return loadDump().then((packets) => {
+    return analyze(packets, 0).then((sess) => {
+      let expected = [];
+      for (let seq = 1; seq <= packets.length; ++seq) {
+        expected.push(snapshot(sess.get(seq)));
+      }
+      sess.close();
+      return expected;
+    }).then((expected) => {
+      return analyze(packets, 64 * 1024).then((sess) => {
+        // Packet wrappers do not keep packets in memory, so the ones
+        // evicted in the meantime read as empty.
+        let wrappers = [];
+        for (let seq = 1; seq <= packets.length; ++seq) {
+          wrappers.push(sess.get(seq));
+        }
+        return sleep(1000).then(() => {
+          let evicted = wrappers.filter(pkt => pkt.seq === undefined);
+          assert(evicted.length > 0, 'no packet was evicted');
+          for (let seq = 1; seq <= packets.length; ++seq) {
+            assert.deepEqual(snapshot(sess.get(seq)), expected[seq - 1]);
+          }
+          sess.close();
+        });
+      });
+    });
+  });
+};
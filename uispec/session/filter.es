@@ -0,0 +1,95 @@
+const {Session} = require('paperfilter');
+const assert = require('assert');
+const {natives, loadDump, waitFor, settled} = require('./helper.es');
+
+// FilterProgram evaluates filters natively and falls back to the V8 filter
+// from makeFilter() only for values it has no semantics for. With
+// native_filter disabled every packet goes through V8, so both sessions
+// must match the same seqs for every filter below.
+const filters = [
+  // Layer presence, answered by the layer mask before any evaluation.
+  'eth', 'tcp', 'udp', '!tcp', 'ipv4 && udp', 'ipv6 || tcp', 'values && !eth',
+  'nothing', '!nothing',
+
+  // Comparisons and abstract equality.
+  'tcp.srcPort == 443', 'tcp.dstPort != 80 && tcp.srcPort < 1024',
+  'ipv4.ttl > 63', 'ipv4.ttl >= "64"', 'ipv4.protocol == "6"',
+  'ipv4.src != ipv4.dst', 'ipv4.ttl == null', 'tcp.missing == undefined',
+  'tcp.srcPort === 443', 'tcp.srcPort !== tcp.dstPort',
+  'values.label == 10', 'values.label == "odd"', 'values.label > 100',
+  'values.flag == 1', 'values.flag == "1"', 'values.empty == null',
+  'values.empty == 0', 'values.empty >= 0', 'eth.src == eth.dst',
+  '"" == 0', '" 12 " == 12', '"0x10" == 16', '"1e3" == 1000',
+
+  // Arithmetic and int32 operators.
+  'length % 7 == 3', 'udp.len - 8 >= 100', 'ipv4.totalLength * 1.5 > 300',
+  'tcp.srcPort + tcp.dstPort > 50000', 'tcp.srcPort / 0 > 1e308',
+  '-tcp.srcPort < -1024', '+values.label > 0', 'values.label * 2 == 20',
+  '(tcp.seq >> 24) & 1', '(tcp.seq << 1) < 0', '~tcp.window < -1000',
+  '(tcp.seq | 0) != tcp.seq', '(tcp.ack ^ tcp.seq) % 2 == 1',
+  'length + "" == "60"', 'values.label + 1 == "odd1"',
+
+  // Member lookup on packets, layers, items and buffers.
+  '$.length == length', 'confidence >= 1', 'seq % 3 == 0 ? tcp : udp',
+  'tcp.flags.SYN', 'tcp.flags.ACK && !tcp.flags.PSH', 'tcp["srcPort"] == 80',
+  'eth.payload.length > 100', 'eth.etherType.name == "IPv4"',
+  'tcp.summary.length > 30', 'eth.name == "Ethernet"', 'eth.id == "eth"',
+
+  // Values without native semantics fall back to V8.
+  'values.json.odd', 'values.json.length == length',
+  'values.json == "[object Object]"', 'values.date > 0',
+  'values.date.getTime() > 0', 'values.date == values.date',
+  'payload.length > 100', 'layers.Ethernet != null',
+
+  // Globals, calls and regular expressions.
+  'Math.max(tcp.srcPort, tcp.dstPort) > 1024', 'ipv4.ttl < Infinity',
+  'isNaN(tcp.srcPort)', 'NaN != NaN', 'undefined == null',
+  '/TCP/.test(eth.summary)'
+];
+
+const run = (packets, option) => {
+  return Session.create(Object.assign({
+    namespace: '::<Ethernet>',
+    dissectors: natives(['ethernet', 'ipv4', 'ipv6', 'tcp', 'udp']).concat([
+      {script: `${__dirname}/fixture/values.es`}
+    ]),
+    threads: 2
+  }, option)).then((sess) => {
+    for (let pkt of packets) {
+      sess.analyze(pkt);
+    }
+    return waitFor(sess, settled(packets.length)).then(() => {
+      filters.forEach((filter, i) => sess.filter(`f${i}`, filter));
+      return waitFor(sess, (stat) => filters.every((filter, i) => {
+        return stat.filteredSeq[`f${i}`] >= packets.length;
+      }));
+    }).then(() => {
+      let results = filters.map((filter, i) => {
+        return sess.getFilteredRange(`f${i}`, 1, packets.length);
+      });
+      sess.close();
+      return results;
+    });
+  });
+};
+
+const compare = (actual, expected, label) => {
+  filters.forEach((filter, i) => {
+    assert.deepEqual(actual[i], expected[i], `${label}: ${filter}`);
+  });
+};
+
+module.exports = () => {
+  return loadDump().then((packets) => {
+    return run(packets, {native_filter: false}).then((expected) => {
+      return run(packets, {}).then((actual) => {
+        compare(actual, expected, 'native');
+        // The field index answers the indexed comparisons of a conjunction
+        // without evaluating them, so it is checked against V8 as well.
+        return run(packets, {field_index: ['tcp.srcPort', 'ipv4.ttl']});
+      }).then((actual) => {
+        compare(actual, expected, 'field_index');
+      });
+    });
+  });
+};
@@ -0,0 +1,26 @@
+import {Layer} from 'dripcap';
+
+// Adds a layer whose items hold the value kinds FilterProgram leaves to V8
+// (JSON objects and dates) next to ones it evaluates natively.
+export default class Dissector {
+  static get namespaces() {
+    return ['::<Ethernet>'];
+  }
+
+  analyze(packet, parentLayer) {
+    const payload = parentLayer.payload;
+    const last = payload.readUInt8(payload.length - 1);
+    return new Layer({
+      namespace: '::Values',
+      name: 'Values',
+      id: 'values',
+      items: [
+        {id: 'json', value: {length: packet.length, odd: last % 2 === 1}},
+        {id: 'date', value: new Date(packet.ts_sec * 1000)},
+        {id: 'label', value: last % 2 ? 'odd' : String(last)},
+        {id: 'flag', value: last % 3 === 0},
+        {id: 'empty', value: null}
+      ]
+    });
+  }
+};
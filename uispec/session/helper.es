@@ -0,0 +1,102 @@
+const msgpack = require('msgpack-lite');
+const fs = require('fs');
+
+// Shared setup for the session tests. Each test module exports a function
+// that returns a promise; main.es runs them in order.
+
+exports.dissectors = (names) => names.map(name => ({
+  script: `${__dirname}/../../packages/dissector/${name}`
+}));
+
+exports.natives = (names) => names.map(name => ({native: name}));
+
+// Resolves with the frames of uispec/test/dump.msgpack in the form taken
+// by Session#analyze.
+exports.loadDump = () => {
+  return new Promise((resolve, reject) => {
+    let packets = [];
+    fs.createReadStream(__dirname + '/../test/dump.msgpack')
+      .pipe(msgpack.createDecodeStream())
+      .on('data', (data) => {
+        if (data.length === 4) {
+          packets.push({
+            ts_sec: data[0],
+            ts_nsec: data[1],
+            length: data[2],
+            payload: data[3]
+          });
+        }
+      })
+      .on('end', () => resolve(packets))
+      .on('error', reject);
+  });
+};
+
+// Resolves once |predicate| holds for a status event, or rejects after
+// |timeout| msec.
+exports.waitFor = (sess, predicate, timeout = 20000) => {
+  return new Promise((resolve, reject) => {
+    let timer = setTimeout(() => {
+      sess.removeListener('status', listener);
+      reject(new Error(`timeout: ${JSON.stringify(sess.status)}`));
+    }, timeout);
+    let listener = (stat) => {
+      if (predicate(stat)) {
+        clearTimeout(timer);
+        sess.removeListener('status', listener);
+        resolve(stat);
+      }
+    };
+    sess.on('status', listener);
+  });
+};
+
+exports.settled = (count) => (stat) => {
+  return stat.packets >= count && stat.queue === 0;
+};
+
+exports.sleep = (msec) => new Promise(resolve => setTimeout(resolve, msec));
+
+// Plain copies of session packets, layers and items for deep comparison.
+const hex = (buf) => Buffer.isBuffer(buf) ? buf.toString('hex') : null;
+
+const itemSnapshot = (item) => ({
+  name: item.name,
+  id: item.id,
+  range: item.range,
+  summary: item.summary,
+  value: JSON.stringify(item.value.data),
+  type: item.value.type,
+  items: item.items.map(itemSnapshot)
+});
+
+const layersSnapshot = (layers) => {
+  let result = {};
+  for (let ns of Object.keys(layers).sort()) {
+    let layer = layers[ns];
+    result[ns] = {
+      name: layer.name,
+      id: layer.id,
+      summary: layer.summary,
+      range: layer.range,
+      confidence: layer.confidence,
+      payload: hex(layer.payload),
+      items: layer.items.map(itemSnapshot),
+      layers: layersSnapshot(layer.layers)
+    };
+  }
+  return result;
+};
+
+exports.layersSnapshot = layersSnapshot;
+
+exports.snapshot = (pkt) => ({
+  seq: pkt.seq,
+  ts_sec: pkt.ts_sec,
+  ts_nsec: pkt.ts_nsec,
+  length: pkt.length,
+  name: pkt.name,
+  summary: pkt.summary,
+  payload: hex(pkt.payload),
+  layers: layersSnapshot(pkt.layers)
+});
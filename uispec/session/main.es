@@ -0,0 +1,17 @@
+// Runs the session tests in order. Usage:
+//   electron uispec/session/main.es [name...]
+
+const tests = process.argv.slice(2).filter(arg => !arg.startsWith('-'));
+const names = tests.length > 0 ? tests : ['reset', 'budget', 'native', 'filter'];
+
+let failed = 0;
+names.reduce((prev, name) => {
+  return prev.then(() => require(`./${name}.es`)()).then(() => {
+    console.log(`ok: ${name}`);
+  }).catch((e) => {
+    failed++;
+    console.warn(`failed: ${name}: ${e && e.stack || e}`);
+  });
+}, Promise.resolve()).then(() => {
+  process.exit(failed > 0 ? 1 : 0);
+});
@@ -0,0 +1,45 @@
+const {Session} = require('paperfilter');
+const assert = require('assert');
+const {
+  dissectors, natives, loadDump, waitFor, settled, layersSnapshot
+} = require('./helper.es');
+
+// The bundled Ethernet, IPv4, IPv6, TCP and UDP packages use the dissectors
+// built into paperfilter. Their scripts are kept as the reference: both
+// must produce the same layers and items for every packet of the dump.
+const analyze = (packets, list) => {
+  return Session.create({
+    namespace: '::<Ethernet>',
+    dissectors: list,
+    threads: 2
+  }).then((sess) => {
+    for (let pkt of packets) {
+      sess.analyze(pkt);
+    }
+    return waitFor(sess, settled(packets.length)).then(() => {
+      let layers = [];
+      for (let seq = 1; seq <= packets.length; ++seq) {
+        layers.push(layersSnapshot(sess.get(seq).layers));
+      }
+      sess.close();
+      return layers;
+    });
+  });
+};
+
+module.exports = () => {
+  return loadDump().then((packets) => {
+    return analyze(packets, dissectors([
+      'ethernet/lib/eth.es', 'ipv4/lib/ipv4.es', 'ipv6/lib/ipv6.es',
+      'tcp/lib/tcp.es', 'udp/lib/udp.es'
+    ])).then((expected) => {
+      return analyze(packets, natives([
+        'ethernet', 'ipv4', 'ipv6', 'tcp', 'udp'
+      ])).then((actual) => {
+        for (let i = 0; i < packets.length; ++i) {
+          assert.deepEqual(actual[i], expected[i], `packet #${i + 1}`);
+        }
+      });
+    });
+  });
+};
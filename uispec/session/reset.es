@@ -0,0 +1,41 @@
+const {Session} = require('paperfilter');
+const assert = require('assert');
+const {dissectors, loadDump, waitFor, settled} = require('./helper.es');
+
+// A reset re-analyzes every stored packet in one burst. The queue limit
+// only applies to the live capture, so none of them may be dropped even
+// with a tiny limit and the drop_newest policy.
+module.exports = () => {
+  return Promise.all([
+    loadDump(),
+    Session.create({
+      namespace: '::<Ethernet>',
+      dissectors: dissectors(['ethernet/lib/eth.es']),
+      threads: 1,
+      queue_limit: 4,
+      queue_policy: 'drop_newest'
+    })
+  ]).then(([packets, sess]) => {
+    for (let pkt of packets) {
+      sess.analyze(pkt);
+    }
+    return waitFor(sess, settled(packets.length)).then((stat) => {
+      assert.equal(stat.packets, packets.length);
+      assert.equal(stat.dropped, 0);
+      let before = [];
+      for (let seq = 1; seq <= stat.packets; ++seq) {
+        before.push(sess.get(seq).length);
+      }
+
+      sess._sess.reset(sess._option);
+      return waitFor(sess, settled(packets.length)).then((stat) => {
+        assert.equal(stat.packets, packets.length);
+        assert.equal(stat.dropped, 0);
+        for (let seq = 1; seq <= stat.packets; ++seq) {
+          assert.equal(sess.get(seq).length, before[seq - 1]);
+        }
+        sess.close();
+      });
+    });
+  });
+};